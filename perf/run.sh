@@ -0,0 +1,31 @@
+#!/bin/sh
+# Runs every benchmark scenario a few times and keeps the per-frame samples.
+#
+#   perf/run.sh <label> [runs] [frames]
+#
+# Results go to perf/results/<label>/<scenario>-<run>.csv (+ .json report).
+# Compare two labels with:
+#   build/perf_compare perf/baselines/orbit-*.csv -- perf/results/<label>/orbit-*.csv
+set -e
+
+label=${1:?usage: perf/run.sh <label> [runs] [frames]}
+runs=${2:-5}
+frames=${3:-2000}
+scenarios="orbit flyby"
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+out="$root/perf/results/$label"
+mkdir -p "$out"
+
+# shader and texture paths are relative to src/
+cd "$root/src"
+for scenario in $scenarios; do
+    run=1
+    while [ $run -le $runs ]; do
+        echo "$scenario run $run/$runs"
+        "$root/build/solar-system" --benchmark $scenario --frames $frames \
+            --report "$out/$scenario-$run.json" --samples "$out/$scenario-$run.csv" > /dev/null
+        run=$((run + 1))
+    done
+done
+echo "results in $out"
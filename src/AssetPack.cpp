@@ -0,0 +1,121 @@
+#include "AssetPack.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+static const unsigned char *mapping = NULL;
+static size_t mappingSize = 0;
+static std::unordered_map<std::string, Asset> assets;
+
+bool AssetPack::mount(const char *path)
+{
+    unmount();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(AssetPackHeader))
+    {
+        std::cout << "Not an asset pack: " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file
+    if (data == MAP_FAILED)
+    {
+        std::cout << "Failed to map asset pack: " << path << std::endl;
+        return false;
+    }
+    mapping = (const unsigned char *)data;
+    mappingSize = info.st_size;
+
+    AssetPackHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    size_t namesStart = sizeof(header) + (size_t)header.entryCount * sizeof(AssetPackEntry);
+    if (memcmp(header.magic, "SAPK", 4) != 0 || header.version != VERSION || namesStart + header.namesSize > mappingSize)
+    {
+        std::cout << "Unsupported asset pack: " << path << std::endl;
+        unmount();
+        return false;
+    }
+
+    const char *names = (const char *)mapping + namesStart;
+    for (unsigned int i = 0; i < header.entryCount; ++i)
+    {
+        AssetPackEntry entry;
+        memcpy(&entry, mapping + sizeof(header) + i * sizeof(AssetPackEntry), sizeof(entry));
+        if (entry.offset + entry.size > mappingSize || (size_t)entry.nameOffset + entry.nameLength > header.namesSize)
+        {
+            std::cout << "Truncated asset pack: " << path << std::endl;
+            unmount();
+            return false;
+        }
+
+        Asset asset = {mapping + entry.offset, (size_t)entry.size, entry.format};
+        assets[std::string(names + entry.nameOffset, entry.nameLength)] = asset;
+    }
+
+    // no madvise: assets are read in the order bodies come into view, baked
+    // levels as they are needed, which suits the default read-ahead
+    std::cout << "Mounted " << path << ": " << assets.size() << " assets, " << mappingSize / 1024 << " KB" << std::endl;
+    return true;
+}
+
+void AssetPack::unmount()
+{
+    if (mapping)
+        munmap((void *)mapping, mappingSize);
+    mapping = NULL;
+    mappingSize = 0;
+    assets.clear();
+}
+
+bool AssetPack::isMounted()
+{
+    return mapping != NULL;
+}
+
+bool AssetPack::find(const std::string &name, Asset &asset)
+{
+    auto it = assets.find(name);
+    if (it == assets.end())
+        return false;
+    asset = it->second;
+    return true;
+}
+
+unsigned long long AssetPack::hash(const unsigned char *data, size_t size)
+{
+    unsigned long long value = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        value ^= data[i];
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
+
+unsigned int AssetPack::getFormat(const std::string &name)
+{
+    std::string extension = name.substr(name.find_last_of('.') + 1);
+    if (extension == "jpg" || extension == "jpeg" || extension == "png")
+        return ASSET_IMAGE;
+    if (extension == "ktx2")
+        return ASSET_KTX2;
+    if (extension == "vs" || extension == "fs")
+        return ASSET_SHADER;
+    return ASSET_RAW;
+}
+
+const char *AssetPack::getFormatName(unsigned int format)
+{
+    static const char *names[ASSET_FORMAT_COUNT] = {"raw", "image", "ktx2", "shader"};
+    return format < ASSET_FORMAT_COUNT ? names[format] : "unknown";
+}
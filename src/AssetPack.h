@@ -0,0 +1,67 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+#include <cstddef>
+#include <string>
+
+enum AssetFormat
+{
+    ASSET_RAW,
+    ASSET_IMAGE,  // JPG/PNG, decoded with stbi_load_from_memory
+    ASSET_KTX2,   // baked texture, uploaded from the mapping
+    ASSET_SHADER, // GLSL source
+    ASSET_FORMAT_COUNT
+};
+
+// On-disk layout: the header, entryCount entries, their names, then the data,
+// each asset aligned to ALIGNMENT. Little-endian, as written by tools/asset_packer.
+struct AssetPackHeader
+{
+    char magic[4]; // 'SAPK'
+    unsigned int version;
+    unsigned int entryCount;
+    unsigned int namesSize; // bytes of names after the entries
+};
+
+struct AssetPackEntry
+{
+    unsigned long long offset; // from the start of the file
+    unsigned long long size;
+    unsigned long long hash; // FNV-1a of the data
+    unsigned int format;     // AssetFormat
+    unsigned int nameOffset; // into the names
+    unsigned int nameLength;
+    unsigned int reserved;
+};
+
+struct Asset
+{
+    const unsigned char *data; // inside the mapping, valid until unmount()
+    size_t size;
+    unsigned int format;
+};
+
+// A single-file archive of the app's assets, mapped read-only once at startup.
+// Loaders look a path up here first and read straight from the mapping
+// (stbi_load_from_memory, glShaderSource, PBO copies), falling back to the
+// loose file when the pack is missing or doesn't have it.
+//
+//   AssetPack::mount("assets.pak");
+//   Asset asset;
+//   if (AssetPack::find("textures/sunmap.jpg", asset)) ...
+class AssetPack
+{
+public:
+    static const unsigned int VERSION = 1;
+    static const unsigned int ALIGNMENT = 64;
+
+    static bool mount(const char *path); // quietly false if there is no pack
+    static void unmount();
+    static bool isMounted();
+    static bool find(const std::string &name, Asset &asset); // thread safe once mounted
+
+    static unsigned long long hash(const unsigned char *data, size_t size);
+    static unsigned int getFormat(const std::string &name); // from the extension
+    static const char *getFormatName(unsigned int format);
+};
+
+#endif
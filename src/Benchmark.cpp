@@ -0,0 +1,272 @@
+#include "Benchmark.h"
+#include "MemoryStats.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+const float Benchmark::TIME_STEP = 1.0f / 60.0f;
+
+bool Benchmark::parseArgs(int argc, char **argv, BenchmarkOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--benchmark") == 0 && hasValue)
+        {
+            options.enabled = true;
+            options.scenario = argv[++i];
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+            options.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+            options.warmupFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--report") == 0 && hasValue)
+            options.reportPath = argv[++i];
+        else if (strcmp(argv[i], "--samples") == 0 && hasValue)
+            options.samplesPath = argv[++i];
+        else if (strcmp(argv[i], "--scene") == 0 && hasValue)
+            options.sceneBodies = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sweep") == 0 && hasValue)
+            options.sweepBodies = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--texture-budget") == 0 && hasValue)
+            options.textureBudgetMB = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tsc") == 0)
+            options.tsc = true;
+        else
+        {
+            std::cout << "Unknown argument: " << argv[i] << std::endl;
+            std::cout << "Usage: solar-system [--benchmark <orbit|flyby|path file>] [--frames N] [--warmup N] [--report file]"
+                      << " [--samples file] [--scene N] [--sweep N] [--texture-budget MB] [--tsc]" << std::endl;
+            return false;
+        }
+    }
+
+    if (options.frames < 1)
+        options.frames = 1;
+    if (options.warmupFrames < 0)
+        options.warmupFrames = 0;
+    return true;
+}
+
+Benchmark::Benchmark(const BenchmarkOptions &options) : options(options), frame(0), totalDrawCalls(0), totalTriangles(0)
+{
+    if (!options.samplesPath.empty())
+        samples.reserve(options.frames * 3);
+}
+
+bool Benchmark::load()
+{
+    path.clear();
+    const float PI = acos(-1.0f);
+
+    if (options.scenario == "orbit")
+    {
+        // one turn around the whole system, looking at the sun
+        for (int i = 0; i <= 16; ++i)
+        {
+            float angle = i * 2.0f * PI / 16;
+            addLookAt(glm::vec3(160.0f * cos(angle), 40.0f, 160.0f * sin(angle)), glm::vec3(0.0f));
+        }
+    }
+    else if (options.scenario == "flyby")
+    {
+        // spiral in through the planet orbits close to the ecliptic, then back out
+        for (int i = 0; i <= 24; ++i)
+        {
+            float angle = i * PI / 6;
+            float radius = 125.0f - 100.0f * sin(i * PI / 24);
+            addLookAt(glm::vec3(radius * cos(angle), 6.0f, radius * sin(angle)), glm::vec3(0.0f));
+        }
+    }
+    else if (!loadFile(options.scenario))
+    {
+        return false;
+    }
+
+    if (path.size() < 2)
+    {
+        std::cout << "Benchmark path needs at least 2 keyframes: " << options.scenario << std::endl;
+        return false;
+    }
+
+    // keep the yaw continuous so interpolation takes the short way around
+    for (size_t i = 1; i < path.size(); ++i)
+    {
+        while (path[i].yaw - path[i - 1].yaw > 180.0f)
+            path[i].yaw -= 360.0f;
+        while (path[i].yaw - path[i - 1].yaw < -180.0f)
+            path[i].yaw += 360.0f;
+    }
+
+    std::cout << "Benchmark " << options.scenario << ": " << path.size() << " keyframes, "
+              << options.warmupFrames << " warmup + " << options.frames << " frames" << std::endl;
+    return true;
+}
+
+void Benchmark::applyCamera(Camera &camera) const
+{
+    // Catmull-Rom through the keyframes, the path is covered once by the measured frames
+    int measured = frame - options.warmupFrames;
+    float t = measured <= 0 ? 0.0f : (float)measured / options.frames;
+    float segment = t * (path.size() - 1);
+    int i1 = (int)segment;
+    if (i1 >= (int)path.size() - 1)
+        i1 = (int)path.size() - 2;
+    float u = segment - i1;
+
+    int i0 = i1 > 0 ? i1 - 1 : 0;
+    int i2 = i1 + 1;
+    int i3 = i2 + 1 < (int)path.size() ? i2 + 1 : i2;
+
+    float u2 = u * u;
+    float u3 = u2 * u;
+    float w0 = -0.5f * u3 + u2 - 0.5f * u;
+    float w1 = 1.5f * u3 - 2.5f * u2 + 1.0f;
+    float w2 = -1.5f * u3 + 2.0f * u2 + 0.5f * u;
+    float w3 = 0.5f * u3 - 0.5f * u2;
+
+    glm::vec3 position = w0 * path[i0].position + w1 * path[i1].position + w2 * path[i2].position + w3 * path[i3].position;
+    float yaw = path[i1].yaw + (path[i2].yaw - path[i1].yaw) * u;
+    float pitch = path[i1].pitch + (path[i2].pitch - path[i1].pitch) * u;
+
+    camera.SetPose(position, yaw, pitch);
+}
+
+void Benchmark::recordSample(double frameMs, double cpuMs, double presentMs)
+{
+    if (isWarmingUp() || options.samplesPath.empty() || samples.size() + 3 > samples.capacity())
+        return;
+
+    samples.push_back((float)frameMs);
+    samples.push_back((float)cpuMs);
+    samples.push_back((float)presentMs);
+}
+
+void Benchmark::endFrame(unsigned int drawCalls, unsigned long long triangles)
+{
+    if (!isWarmingUp())
+    {
+        totalDrawCalls += drawCalls;
+        totalTriangles += triangles;
+    }
+    frame++;
+}
+
+bool Benchmark::writeReport(const FrameStats &stats) const
+{
+    FILE *file = fopen(options.reportPath.c_str(), "w");
+    if (!file)
+    {
+        std::cout << "Failed to write benchmark report: " << options.reportPath << std::endl;
+        return false;
+    }
+
+    long long rssBytes = 0, peakRssBytes = 0;
+#ifdef __linux__
+    long pages = 0, residentPages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm)
+    {
+        if (fscanf(statm, "%ld %ld", &pages, &residentPages) == 2)
+            rssBytes = (long long)residentPages * sysconf(_SC_PAGESIZE);
+        fclose(statm);
+    }
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        peakRssBytes = usage.ru_maxrss * 1024LL;
+#endif
+
+    int measured = frame - options.warmupFrames;
+    if (measured < 1)
+        measured = 1;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"scenario\": \"%s\",\n", options.scenario.c_str());
+    fprintf(file, "  \"frames\": %d,\n", frame - options.warmupFrames);
+    fprintf(file, "  \"warmup_frames\": %d,\n", options.warmupFrames);
+    fprintf(file, "  \"time_step_s\": %.6f,\n", TIME_STEP);
+    fprintf(file, "  \"draw_calls_per_frame\": %.2f,\n", (double)totalDrawCalls / measured);
+    fprintf(file, "  \"triangles_per_frame\": %.0f,\n", (double)totalTriangles / measured);
+    fprintf(file, "  \"rss_bytes\": %lld,\n", rssBytes);
+    fprintf(file, "  \"peak_rss_bytes\": %lld,\n", peakRssBytes);
+    fprintf(file, "  \"memory\": {\n");
+    MemoryStats::writeJson(file, "    ");
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"frame_times\": {\n");
+    for (int i = 0; i < FRAME_METRIC_COUNT; ++i)
+    {
+        const Histogram &histogram = stats.get((FrameMetric)i);
+        fprintf(file, "    \"%s\": {\"count\": %llu, \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p95_ms\": %.3f, \"p99_ms\": %.3f, \"p99.9_ms\": %.3f, \"max_ms\": %.3f}%s\n",
+                FrameStats::getMetricName((FrameMetric)i), histogram.getCount(), histogram.getMean(),
+                histogram.getPercentile(50.0), histogram.getPercentile(95.0), histogram.getPercentile(99.0),
+                histogram.getPercentile(99.9), histogram.getMax(), i + 1 < FRAME_METRIC_COUNT ? "," : "");
+    }
+    fprintf(file, "  }\n}\n");
+    fclose(file);
+
+    std::cout << "Wrote benchmark report to " << options.reportPath << std::endl;
+    return true;
+}
+
+bool Benchmark::writeSamples() const
+{
+    if (options.samplesPath.empty())
+        return true;
+
+    FILE *file = fopen(options.samplesPath.c_str(), "w");
+    if (!file)
+    {
+        std::cout << "Failed to write benchmark samples: " << options.samplesPath << std::endl;
+        return false;
+    }
+
+    fprintf(file, "frame_ms,cpu_ms,present_ms\n");
+    for (size_t i = 0; i + 2 < samples.size(); i += 3)
+        fprintf(file, "%.4f,%.4f,%.4f\n", samples[i], samples[i + 1], samples[i + 2]);
+    fclose(file);
+
+    std::cout << "Wrote " << samples.size() / 3 << " benchmark samples to " << options.samplesPath << std::endl;
+    return true;
+}
+
+void Benchmark::addLookAt(glm::vec3 position, glm::vec3 target)
+{
+    glm::vec3 dir = glm::normalize(target - position);
+
+    Keyframe key;
+    key.position = position;
+    key.yaw = glm::degrees(atan2(dir.z, dir.x));
+    key.pitch = glm::degrees(asin(dir.y));
+    path.push_back(key);
+}
+
+bool Benchmark::loadFile(const std::string &filename)
+{
+    std::ifstream file(filename.c_str());
+    if (!file)
+    {
+        std::cout << "Unknown benchmark scenario or path file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream fields(line);
+        Keyframe key;
+        if (fields >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch)
+            path.push_back(key);
+    }
+    return true;
+}
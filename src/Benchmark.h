@@ -0,0 +1,73 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "Camera.h"
+#include "FrameStats.h"
+
+// --benchmark <scenario> [--frames N] [--warmup N] [--report file] [--samples file]
+// Flies the camera along a scripted path with a fixed simulation timestep and
+// writes a JSON report. <scenario> is a built-in path ("orbit", "flyby") or a
+// camera path file with one "x y z yaw pitch" keyframe per line. --samples
+// also writes every measured frame as CSV, for perf_compare.
+//
+// --scene N replaces the solar system by a generated scene of N bodies,
+// --sweep N prints the per-body cost of scenes of 10 up to N bodies and exits.
+struct BenchmarkOptions
+{
+    bool enabled;
+    std::string scenario;
+    int frames;
+    int warmupFrames;
+    std::string reportPath;
+    std::string samplesPath; // empty: no samples
+    int sceneBodies; // 0: the hand-made solar system
+    int sweepBodies; // 0: no sweep
+    int textureBudgetMB; // 0: TextureManager::RESIDENCY_BUDGET
+    bool tsc; // time with the invariant TSC instead of the OS monotonic clock
+
+    BenchmarkOptions() : enabled(false), frames(1000), warmupFrames(60), reportPath("benchmark-report.json"),
+                         sceneBodies(0), sweepBodies(0), textureBudgetMB(0), tsc(false) {}
+};
+
+class Benchmark
+{
+public:
+    static const float TIME_STEP; // fixed simulation step
+
+    // returns false on bad arguments
+    static bool parseArgs(int argc, char **argv, BenchmarkOptions &options);
+
+    Benchmark(const BenchmarkOptions &options);
+
+    bool load();                      // build the camera path of the scenario
+    bool isDone() const { return frame >= options.warmupFrames + options.frames; }
+    bool isWarmingUp() const { return frame < options.warmupFrames; }
+    void applyCamera(Camera &camera) const; // camera pose of the current frame
+    void recordSample(double frameMs, double cpuMs, double presentMs);
+    void endFrame(unsigned int drawCalls, unsigned long long triangles);
+
+    bool writeReport(const FrameStats &stats) const;
+    bool writeSamples() const;
+
+private:
+    struct Keyframe
+    {
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+    };
+
+    void addLookAt(glm::vec3 position, glm::vec3 target);
+    bool loadFile(const std::string &path);
+
+    BenchmarkOptions options;
+    std::vector<Keyframe> path;
+    std::vector<float> samples; // frame, cpu, present ms per measured frame, reserved up front
+    int frame;
+    unsigned long long totalDrawCalls;
+    unsigned long long totalTriangles;
+};
+
+#endif
@@ -43,6 +43,7 @@ public:
     void ProcessKeyboard(Camera_Movement direction, float deltaTime);
     void ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch = true);
     void ProcessMouseScroll(float yoffset);
+    void SetPose(glm::vec3 position, float yaw, float pitch);
 
 private:
     void updateCameraVectors();
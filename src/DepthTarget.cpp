@@ -0,0 +1,183 @@
+#include "DepthTarget.h"
+#include "MemoryStats.h"
+#include <GLFW/glfw3.h>
+#include <cmath>
+#include <iostream>
+
+// GL 4.5 / ARB_clip_control, not part of the 3.3 core glad loader
+#ifndef GL_ZERO_TO_ONE
+#define GL_ZERO_TO_ONE 0x935F
+#endif
+#ifndef GL_NEGATIVE_ONE_TO_ONE
+#define GL_NEGATIVE_ONE_TO_ONE 0x935E
+#endif
+typedef void (*PFNCLIPCONTROLPROC)(GLenum origin, GLenum depth);
+static PFNCLIPCONTROLPROC clipControl = NULL;
+
+const char *const DepthTarget::LOG_DEPTH_DEFINES = "#define LOG_DEPTH\n";
+
+DepthTarget::DepthTarget(int width, int height) : mode(DEPTH_STANDARD), width(width), height(height), farPlane(1000.0f),
+                                                  FBO(0), colorRBO(0), depthRBO(0)
+{
+}
+
+DepthTarget::~DepthTarget()
+{
+    deleteFramebuffer();
+}
+
+bool DepthTarget::isReversedZSupported()
+{
+    if (!clipControl && glfwExtensionSupported("GL_ARB_clip_control"))
+        clipControl = (PFNCLIPCONTROLPROC)glfwGetProcAddress("glClipControl");
+    return clipControl != NULL;
+}
+
+DepthMode DepthTarget::bestMode()
+{
+    return isReversedZSupported() ? DEPTH_REVERSED_Z : DEPTH_LOGARITHMIC;
+}
+
+void DepthTarget::setMode(DepthMode newMode)
+{
+    if (newMode == DEPTH_REVERSED_Z && !isReversedZSupported())
+    {
+        std::cout << "Reversed-Z needs glClipControl, using logarithmic depth" << std::endl;
+        newMode = DEPTH_LOGARITHMIC;
+    }
+    mode = newMode;
+
+    if (mode == DEPTH_REVERSED_Z)
+    {
+        clipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        createFramebuffer();
+    }
+    else
+    {
+        if (clipControl)
+            clipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+        deleteFramebuffer();
+    }
+
+    std::cout << "Depth mode: " << getModeName() << std::endl;
+}
+
+void DepthTarget::nextMode()
+{
+    DepthMode next = (DepthMode)((mode + 1) % 3);
+    if (next == DEPTH_REVERSED_Z && !isReversedZSupported())
+        next = DEPTH_LOGARITHMIC;
+    setMode(next);
+}
+
+const char *DepthTarget::getModeName() const
+{
+    switch (mode)
+    {
+    case DEPTH_REVERSED_Z:
+        return "reversed-Z";
+    case DEPTH_LOGARITHMIC:
+        return "logarithmic";
+    default:
+        return "standard";
+    }
+}
+
+void DepthTarget::resize(int w, int h)
+{
+    width = w;
+    height = h;
+    if (FBO)
+        createFramebuffer();
+}
+
+void DepthTarget::begin(const glm::vec4 &clearColor)
+{
+    if (mode == DEPTH_REVERSED_Z)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glClearDepth(0.0);
+        glDepthFunc(GL_GREATER);
+    }
+    else
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glClearDepth(1.0);
+        glDepthFunc(GL_LESS);
+    }
+
+    glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DepthTarget::end()
+{
+    if (mode != DEPTH_REVERSED_Z)
+        return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+glm::mat4 DepthTarget::getProjection(float fovy, float aspect, float zNear, float zFar)
+{
+    farPlane = zFar;
+
+    if (mode != DEPTH_REVERSED_Z)
+        return glm::perspective(fovy, aspect, zNear, zFar);
+
+    // [0,1] depth remapped to 1 - z, so the float precision is spent at the far plane
+    glm::mat4 reverse(1.0f);
+    reverse[2][2] = -1.0f;
+    reverse[3][2] = 1.0f;
+    return reverse * glm::perspectiveRH_ZO(fovy, aspect, zNear, zFar);
+}
+
+void DepthTarget::setUniforms(const Shader &shader) const
+{
+    // only the LOG_DEPTH variants have it
+    if (mode == DEPTH_LOGARITHMIC)
+        shader.setFloat("logDepthCoef", 2.0f / std::log2(farPlane + 1.0f));
+}
+
+void DepthTarget::createFramebuffer()
+{
+    deleteFramebuffer();
+
+    glGenRenderbuffers(1, &colorRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &depthRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    MemoryStats::trackGpu(MEM_TARGET, colorRBO, (long long)width * height * 4);
+    MemoryStats::trackGpu(MEM_TARGET, depthRBO, (long long)width * height * 4);
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::DEPTH_TARGET::FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DepthTarget::deleteFramebuffer()
+{
+    if (!FBO)
+        return;
+
+    MemoryStats::untrackGpu(MEM_TARGET, colorRBO);
+    MemoryStats::untrackGpu(MEM_TARGET, depthRBO);
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(1, &colorRBO);
+    glDeleteRenderbuffers(1, &depthRBO);
+    FBO = colorRBO = depthRBO = 0;
+}
@@ -0,0 +1,53 @@
+#ifndef DEPTH_TARGET_H
+#define DEPTH_TARGET_H
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Shader.h"
+
+// depth buffer layout
+enum DepthMode
+{
+    DEPTH_STANDARD,    // [-1,1] clip depth into the default fixed-point depth buffer
+    DEPTH_REVERSED_Z,  // [0,1] clip depth, far at 0, into a float depth attachment (needs glClipControl)
+    DEPTH_LOGARITHMIC  // logarithmic gl_FragDepth written by the LOG_DEPTH shader variants, works on plain GL 3.3
+};
+
+class DepthTarget
+{
+public:
+    // Shader defines of the variants for DEPTH_LOGARITHMIC. The other modes use
+    // shaders without them, which keep early depth testing.
+    static const char *const LOG_DEPTH_DEFINES;
+
+    DepthTarget(int width, int height);
+    ~DepthTarget();
+
+    static bool isReversedZSupported();
+    static DepthMode bestMode();
+
+    void setMode(DepthMode mode);
+    DepthMode getMode() const { return mode; }
+    bool isLogarithmic() const { return mode == DEPTH_LOGARITHMIC; } // draw with the LOG_DEPTH variants
+    void nextMode(); // cycle through the supported modes
+    const char *getModeName() const;
+
+    void resize(int width, int height);
+
+    void begin(const glm::vec4 &clearColor); // bind and clear the target of the current mode
+    void end();                              // resolve into the default framebuffer
+
+    glm::mat4 getProjection(float fovy, float aspect, float zNear, float zFar);
+    void setUniforms(const Shader &shader) const; // the shader of the mode's variant
+
+private:
+    void createFramebuffer();
+    void deleteFramebuffer();
+
+    DepthMode mode;
+    int width, height;
+    float farPlane;
+    unsigned int FBO, colorRBO, depthRBO;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "FrameStats.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// reported percentiles
+static const double PERCENTILES[] = {50.0, 95.0, 99.0, 99.9};
+static const char *PERCENTILE_NAMES[] = {"p50", "p95", "p99", "p99.9"};
+static const int PERCENTILE_COUNT = 4;
+
+Histogram::Histogram()
+{
+    reset();
+}
+
+void Histogram::record(double ms)
+{
+    double us = ms * 1000.0;
+    if (!(us > 0.0)) // also rejects NaN
+        us = 0.0;
+    if (us > 4294967295.0)
+        us = 4294967295.0;
+
+    unsigned long long value = (unsigned long long)llround(us);
+    counts[getIndex(value)]++;
+    count++;
+    sumUs += (double)value;
+    if (value > maxUs)
+        maxUs = value;
+}
+
+void Histogram::reset()
+{
+    memset(counts, 0, sizeof(counts));
+    count = 0;
+    maxUs = 0;
+    sumUs = 0.0;
+}
+
+double Histogram::getMean() const
+{
+    return count ? sumUs / count * 0.001 : 0.0;
+}
+
+double Histogram::getMax() const
+{
+    return maxUs * 0.001;
+}
+
+double Histogram::getPercentile(double percent) const
+{
+    if (count == 0)
+        return 0.0;
+
+    unsigned long long rank = (unsigned long long)ceil(percent / 100.0 * count);
+    if (rank < 1)
+        rank = 1;
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            unsigned long long value = getValue(i);
+            return (value < maxUs ? value : maxUs) * 0.001;
+        }
+    }
+    return getMax();
+}
+
+// values below SUB_COUNT get their own bucket, above that every power of two
+// is split in HALF_COUNT buckets
+int Histogram::getIndex(unsigned long long us)
+{
+    if (us < SUB_COUNT)
+        return (int)us;
+
+    int msb = SUB_BITS;
+    while (us >> (msb + 1))
+        msb++;
+    int shift = msb - SUB_BITS + 1;
+    return shift * HALF_COUNT + (int)(us >> shift);
+}
+
+unsigned long long Histogram::getValue(int index)
+{
+    if (index < SUB_COUNT)
+        return index;
+
+    int shift = (index - HALF_COUNT) / HALF_COUNT;
+    unsigned long long top = index - shift * HALF_COUNT;
+    return ((top + 1) << shift) - 1;
+}
+
+void FrameStats::reset()
+{
+    for (int i = 0; i < FRAME_METRIC_COUNT; ++i)
+        histograms[i].reset();
+}
+
+const char *FrameStats::getMetricName(FrameMetric metric)
+{
+    switch (metric)
+    {
+    case FRAME_TOTAL:
+        return "frame";
+    case FRAME_CPU:
+        return "cpu";
+    case FRAME_GPU:
+        return "gpu";
+    case FRAME_PRESENT:
+        return "present";
+    default:
+        return "unknown";
+    }
+}
+
+void FrameStats::getSummary(char *line, size_t size) const
+{
+    const Histogram &frame = histograms[FRAME_TOTAL];
+    const Histogram &cpu = histograms[FRAME_CPU];
+    const Histogram &gpu = histograms[FRAME_GPU];
+
+    snprintf(line, size, "%.1f fps | frame p50 %.2f p99 %.2f max %.2f ms | cpu p99 %.2f ms | gpu p99 %.2f ms",
+             frame.getMean() > 0.0 ? 1000.0 / frame.getMean() : 0.0,
+             frame.getPercentile(50.0), frame.getPercentile(99.0), frame.getMax(),
+             cpu.getPercentile(99.0), gpu.getPercentile(99.0));
+}
+
+bool FrameStats::writeCsv(const char *path) const
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        std::cout << "Failed to write frame stats: " << path << std::endl;
+        return false;
+    }
+
+    fprintf(file, "metric,count,mean_ms");
+    for (int p = 0; p < PERCENTILE_COUNT; ++p)
+        fprintf(file, ",%s_ms", PERCENTILE_NAMES[p]);
+    fprintf(file, ",max_ms\n");
+
+    for (int i = 0; i < FRAME_METRIC_COUNT; ++i)
+    {
+        const Histogram &histogram = histograms[i];
+        fprintf(file, "%s,%llu,%.3f", getMetricName((FrameMetric)i), histogram.getCount(), histogram.getMean());
+        for (int p = 0; p < PERCENTILE_COUNT; ++p)
+            fprintf(file, ",%.3f", histogram.getPercentile(PERCENTILES[p]));
+        fprintf(file, ",%.3f\n", histogram.getMax());
+    }
+
+    fclose(file);
+    std::cout << "Wrote frame stats to " << path << std::endl;
+    return true;
+}
+
+bool FrameStats::writeJson(const char *path) const
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        std::cout << "Failed to write frame stats: " << path << std::endl;
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    for (int i = 0; i < FRAME_METRIC_COUNT; ++i)
+    {
+        const Histogram &histogram = histograms[i];
+        fprintf(file, "  \"%s\": {\"count\": %llu, \"mean_ms\": %.3f", getMetricName((FrameMetric)i), histogram.getCount(), histogram.getMean());
+        for (int p = 0; p < PERCENTILE_COUNT; ++p)
+            fprintf(file, ", \"%s_ms\": %.3f", PERCENTILE_NAMES[p], histogram.getPercentile(PERCENTILES[p]));
+        fprintf(file, ", \"max_ms\": %.3f}%s\n", histogram.getMax(), i + 1 < FRAME_METRIC_COUNT ? "," : "");
+    }
+    fprintf(file, "}\n");
+
+    fclose(file);
+    std::cout << "Wrote frame stats to " << path << std::endl;
+    return true;
+}
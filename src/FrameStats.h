@@ -0,0 +1,63 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+#include <cstddef>
+
+// Log-linear histogram in the style of HdrHistogram: values are kept in
+// micro-seconds with 256 linear sub-buckets per power of two, so any
+// percentile is exact to within 1/128 of its value, in a fixed 13 KB of memory.
+class Histogram
+{
+public:
+    Histogram();
+
+    void record(double ms);
+    void reset();
+
+    unsigned long long getCount() const { return count; }
+    double getMean() const;                     // ms
+    double getMax() const;                      // ms
+    double getPercentile(double percent) const; // ms, percent in [0, 100]
+
+private:
+    static const int SUB_BITS = 8;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int HALF_COUNT = SUB_COUNT / 2;
+    static const int MAX_SHIFT = 32 - SUB_BITS; // values up to 2^32 us (~71 minutes)
+    static const int BUCKET_COUNT = SUB_COUNT + MAX_SHIFT * HALF_COUNT;
+
+    static int getIndex(unsigned long long us);
+    static unsigned long long getValue(int index); // highest value of a bucket
+
+    unsigned int counts[BUCKET_COUNT];
+    unsigned long long count;
+    unsigned long long maxUs;
+    double sumUs;
+};
+
+enum FrameMetric
+{
+    FRAME_TOTAL,   // frame to frame
+    FRAME_CPU,     // CPU work of a frame, before present
+    FRAME_GPU,     // GPU time of a frame, from GpuProfiler
+    FRAME_PRESENT, // time spent in the buffer swap
+    FRAME_METRIC_COUNT
+};
+
+class FrameStats
+{
+public:
+    void record(FrameMetric metric, double ms) { histograms[metric].record(ms); }
+    void reset();
+
+    const Histogram &get(FrameMetric metric) const { return histograms[metric]; }
+    static const char *getMetricName(FrameMetric metric);
+
+    void getSummary(char *line, size_t size) const; // one line for the overlay, does not allocate
+    bool writeCsv(const char *path) const;
+    bool writeJson(const char *path) const;
+
+private:
+    Histogram histograms[FRAME_METRIC_COUNT];
+};
+
+#endif
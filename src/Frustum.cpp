@@ -0,0 +1,27 @@
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4 &m)
+{
+    // Gribb/Hartmann: rows of the clip matrix, -w <= x,y <= w
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+
+    for (int i = 0; i < 4; ++i)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+#include <glm/glm.hpp>
+
+// view frustum for culling bodies by their bounding sphere.
+// only the four side planes are kept, so it works with every depth mode of
+// DepthTarget; what lies beyond the far plane is left to the clipper.
+class Frustum
+{
+public:
+    Frustum(const glm::mat4 &viewProjection);
+
+    bool intersectsSphere(const glm::vec3 &center, float radius) const;
+
+private:
+    glm::vec4 planes[4]; // left, right, bottom, top; xyz normalized, pointing inside
+};
+
+#endif
@@ -0,0 +1,317 @@
+#include "GlStats.h"
+
+#ifdef SOLAR_GL_STATS
+#include <glad/glad.h>
+#include <iostream>
+#include <iomanip>
+
+// GL is only called from the main thread
+static unsigned long long calls[GL_CALL_GROUP_COUNT];
+static unsigned long long bytes[GL_CALL_GROUP_COUNT];
+static unsigned long long lastCalls[GL_CALL_GROUP_COUNT];
+static unsigned long long lastBytes[GL_CALL_GROUP_COUNT];
+static unsigned long long totalCalls[GL_CALL_GROUP_COUNT];
+static unsigned long long totalBytes[GL_CALL_GROUP_COUNT];
+static unsigned long long maxCalls[GL_CALL_GROUP_COUNT];
+static unsigned long long maxBytes[GL_CALL_GROUP_COUNT];
+static unsigned long long frameCount = 0;
+
+// with a pixel unpack buffer bound, the pixels pointer of glTex* is an offset into it
+static GLuint unpackBuffer = 0;
+
+static unsigned long long getPixelBytes(GLenum format, GLenum type)
+{
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE_3_3_2:
+    case GL_UNSIGNED_BYTE_2_3_3_REV:
+        return 1;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+        return 2;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_5_9_9_9_REV:
+        return 4;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        return 8;
+    }
+
+    unsigned long long components = 4;
+    switch (format)
+    {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+    case GL_STENCIL_INDEX:
+        components = 1;
+        break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+        components = 2;
+        break;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+    case GL_BGR_INTEGER:
+        components = 3;
+        break;
+    }
+
+    switch (type)
+    {
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return components * 2;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return components * 4;
+    }
+    return components;
+}
+
+static void countTexture(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
+{
+    calls[GL_CALLS_TEXTURE]++;
+    if (pixels || unpackBuffer)
+        bytes[GL_CALLS_TEXTURE] += (unsigned long long)width * height * depth * getPixelBytes(format, type);
+}
+
+// counting wrappers, each forwards to the pointer glad loaded
+#define COUNTED(group, name, params, args) \
+    static decltype(glad_##name) real_##name; \
+    static void APIENTRY counted_##name params \
+    { \
+        calls[group]++; \
+        real_##name args; \
+    }
+
+COUNTED(GL_CALLS_DRAW, glDrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+COUNTED(GL_CALLS_DRAW, glDrawElements, (GLenum mode, GLsizei count, GLenum type, const void *indices), (mode, count, type, indices))
+COUNTED(GL_CALLS_DRAW, glDrawArraysInstanced, (GLenum mode, GLint first, GLsizei count, GLsizei instances), (mode, first, count, instances))
+COUNTED(GL_CALLS_DRAW, glDrawElementsInstanced, (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances),
+        (mode, count, type, indices, instances))
+COUNTED(GL_CALLS_DRAW, glDrawElementsBaseVertex, (GLenum mode, GLsizei count, GLenum type, const void *indices, GLint base),
+        (mode, count, type, indices, base))
+COUNTED(GL_CALLS_DRAW, glDrawRangeElements, (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices),
+        (mode, start, end, count, type, indices))
+
+COUNTED(GL_CALLS_UNIFORM, glUniform1i, (GLint location, GLint v0), (location, v0))
+COUNTED(GL_CALLS_UNIFORM, glUniform1f, (GLint location, GLfloat v0), (location, v0))
+COUNTED(GL_CALLS_UNIFORM, glUniform2f, (GLint location, GLfloat v0, GLfloat v1), (location, v0, v1))
+COUNTED(GL_CALLS_UNIFORM, glUniform3f, (GLint location, GLfloat v0, GLfloat v1, GLfloat v2), (location, v0, v1, v2))
+COUNTED(GL_CALLS_UNIFORM, glUniform4f, (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3), (location, v0, v1, v2, v3))
+COUNTED(GL_CALLS_UNIFORM, glUniform1fv, (GLint location, GLsizei count, const GLfloat *value), (location, count, value))
+COUNTED(GL_CALLS_UNIFORM, glUniform2fv, (GLint location, GLsizei count, const GLfloat *value), (location, count, value))
+COUNTED(GL_CALLS_UNIFORM, glUniform3fv, (GLint location, GLsizei count, const GLfloat *value), (location, count, value))
+COUNTED(GL_CALLS_UNIFORM, glUniform4fv, (GLint location, GLsizei count, const GLfloat *value), (location, count, value))
+COUNTED(GL_CALLS_UNIFORM, glUniformMatrix2fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value),
+        (location, count, transpose, value))
+COUNTED(GL_CALLS_UNIFORM, glUniformMatrix3fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value),
+        (location, count, transpose, value))
+COUNTED(GL_CALLS_UNIFORM, glUniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value),
+        (location, count, transpose, value))
+
+COUNTED(GL_CALLS_BIND, glUseProgram, (GLuint program), (program))
+COUNTED(GL_CALLS_BIND, glBindVertexArray, (GLuint array), (array))
+COUNTED(GL_CALLS_BIND, glBindTexture, (GLenum target, GLuint texture), (target, texture))
+COUNTED(GL_CALLS_BIND, glBindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer))
+COUNTED(GL_CALLS_BIND, glBindRenderbuffer, (GLenum target, GLuint renderbuffer), (target, renderbuffer))
+COUNTED(GL_CALLS_BIND, glBindSampler, (GLuint unit, GLuint sampler), (unit, sampler))
+
+static decltype(glad_glBindBuffer) real_glBindBuffer;
+static void APIENTRY counted_glBindBuffer(GLenum target, GLuint buffer)
+{
+    calls[GL_CALLS_BIND]++;
+    if (target == GL_PIXEL_UNPACK_BUFFER)
+        unpackBuffer = buffer;
+    real_glBindBuffer(target, buffer);
+}
+
+static decltype(glad_glBufferData) real_glBufferData;
+static void APIENTRY counted_glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    calls[GL_CALLS_BUFFER]++;
+    if (data)
+        bytes[GL_CALLS_BUFFER] += size;
+    real_glBufferData(target, size, data, usage);
+}
+
+static decltype(glad_glBufferSubData) real_glBufferSubData;
+static void APIENTRY counted_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+    calls[GL_CALLS_BUFFER]++;
+    bytes[GL_CALLS_BUFFER] += size;
+    real_glBufferSubData(target, offset, size, data);
+}
+
+static decltype(glad_glTexImage2D) real_glTexImage2D;
+static void APIENTRY counted_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+                                          GLenum format, GLenum type, const void *pixels)
+{
+    countTexture(width, height, 1, format, type, pixels);
+    real_glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+static decltype(glad_glTexImage3D) real_glTexImage3D;
+static void APIENTRY counted_glTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+                                          GLint border, GLenum format, GLenum type, const void *pixels)
+{
+    countTexture(width, height, depth, format, type, pixels);
+    real_glTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+}
+
+static decltype(glad_glTexSubImage2D) real_glTexSubImage2D;
+static void APIENTRY counted_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                             GLenum format, GLenum type, const void *pixels)
+{
+    countTexture(width, height, 1, format, type, pixels);
+    real_glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+static decltype(glad_glTexSubImage3D) real_glTexSubImage3D;
+static void APIENTRY counted_glTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+                                             GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
+{
+    countTexture(width, height, depth, format, type, pixels);
+    real_glTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+}
+
+static decltype(glad_glCompressedTexImage2D) real_glCompressedTexImage2D;
+static void APIENTRY counted_glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+                                                    GLint border, GLsizei imageSize, const void *data)
+{
+    calls[GL_CALLS_TEXTURE]++;
+    bytes[GL_CALLS_TEXTURE] += imageSize;
+    real_glCompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+}
+
+static decltype(glad_glCompressedTexSubImage2D) real_glCompressedTexSubImage2D;
+static void APIENTRY counted_glCompressedTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                                                       GLsizei height, GLenum format, GLsizei imageSize, const void *data)
+{
+    calls[GL_CALLS_TEXTURE]++;
+    bytes[GL_CALLS_TEXTURE] += imageSize;
+    real_glCompressedTexSubImage2D(target, level, xoffset, yoffset, width, height, format, imageSize, data);
+}
+
+#define INSTALL(name) \
+    if (glad_##name) \
+    { \
+        real_##name = glad_##name; \
+        glad_##name = counted_##name; \
+    }
+
+void GlStats::install()
+{
+    INSTALL(glDrawArrays)
+    INSTALL(glDrawElements)
+    INSTALL(glDrawArraysInstanced)
+    INSTALL(glDrawElementsInstanced)
+    INSTALL(glDrawElementsBaseVertex)
+    INSTALL(glDrawRangeElements)
+
+    INSTALL(glUniform1i)
+    INSTALL(glUniform1f)
+    INSTALL(glUniform2f)
+    INSTALL(glUniform3f)
+    INSTALL(glUniform4f)
+    INSTALL(glUniform1fv)
+    INSTALL(glUniform2fv)
+    INSTALL(glUniform3fv)
+    INSTALL(glUniform4fv)
+    INSTALL(glUniformMatrix2fv)
+    INSTALL(glUniformMatrix3fv)
+    INSTALL(glUniformMatrix4fv)
+
+    INSTALL(glUseProgram)
+    INSTALL(glBindVertexArray)
+    INSTALL(glBindTexture)
+    INSTALL(glBindFramebuffer)
+    INSTALL(glBindRenderbuffer)
+    INSTALL(glBindSampler)
+    INSTALL(glBindBuffer)
+
+    INSTALL(glBufferData)
+    INSTALL(glBufferSubData)
+
+    INSTALL(glTexImage2D)
+    INSTALL(glTexImage3D)
+    INSTALL(glTexSubImage2D)
+    INSTALL(glTexSubImage3D)
+    INSTALL(glCompressedTexImage2D)
+    INSTALL(glCompressedTexSubImage2D)
+
+    std::cout << "GL call counters installed" << std::endl;
+}
+
+void GlStats::beginFrame()
+{
+    // calls between frames (loading) are not part of any frame
+    for (int i = 0; i < GL_CALL_GROUP_COUNT; ++i)
+    {
+        calls[i] = 0;
+        bytes[i] = 0;
+    }
+}
+
+void GlStats::endFrame()
+{
+    for (int i = 0; i < GL_CALL_GROUP_COUNT; ++i)
+    {
+        lastCalls[i] = calls[i];
+        lastBytes[i] = bytes[i];
+        totalCalls[i] += calls[i];
+        totalBytes[i] += bytes[i];
+        if (calls[i] > maxCalls[i])
+            maxCalls[i] = calls[i];
+        if (bytes[i] > maxBytes[i])
+            maxBytes[i] = bytes[i];
+    }
+    frameCount++;
+}
+
+unsigned long long GlStats::getFrameCalls(GlCallGroup group)
+{
+    return lastCalls[group];
+}
+
+unsigned long long GlStats::getFrameBytes(GlCallGroup group)
+{
+    return lastBytes[group];
+}
+
+const char *GlStats::getGroupName(GlCallGroup group)
+{
+    static const char *names[GL_CALL_GROUP_COUNT] = {"draw", "uniform", "bind", "buffer", "texture"};
+    return group < GL_CALL_GROUP_COUNT ? names[group] : "unknown";
+}
+
+void GlStats::printReport()
+{
+    if (!frameCount)
+        return;
+
+    std::cout << "GL per frame over " << frameCount << " frames:" << std::endl;
+    std::cout << "  group      calls avg       max    KB avg    KB max" << std::endl;
+    for (int i = 0; i < GL_CALL_GROUP_COUNT; ++i)
+    {
+        GlCallGroup group = (GlCallGroup)i;
+        std::cout << "  " << std::left << std::setw(10) << getGroupName(group) << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << (double)totalCalls[i] / frameCount << std::setw(10) << maxCalls[i]
+                  << std::setw(10) << totalBytes[i] / 1024.0 / frameCount << std::setw(10) << maxBytes[i] / 1024 << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+#endif
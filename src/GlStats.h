@@ -0,0 +1,42 @@
+#ifndef GL_STATS_H
+#define GL_STATS_H
+
+enum GlCallGroup
+{
+    GL_CALLS_DRAW,    // glDraw*
+    GL_CALLS_UNIFORM, // glUniform*
+    GL_CALLS_BIND,    // glBind*, glUseProgram
+    GL_CALLS_BUFFER,  // glBufferData, glBufferSubData
+    GL_CALLS_TEXTURE, // glTexImage*, glTexSubImage*, glCompressedTex*
+    GL_CALL_GROUP_COUNT
+};
+
+// GL call and upload byte counters. install() swaps glad's function pointers
+// for counting wrappers that forward to the driver. Only built with SOLAR_GL_STATS;
+// otherwise every method is an empty inline and glad is left alone.
+class GlStats
+{
+public:
+#ifdef SOLAR_GL_STATS
+    static void install(); // after gladLoadGLLoader
+    static void beginFrame();
+    static void endFrame();
+
+    // last finished frame
+    static unsigned long long getFrameCalls(GlCallGroup group);
+    static unsigned long long getFrameBytes(GlCallGroup group);
+    static const char *getGroupName(GlCallGroup group);
+
+    static void printReport();
+#else
+    static void install() {}
+    static void beginFrame() {}
+    static void endFrame() {}
+    static unsigned long long getFrameCalls(GlCallGroup) { return 0; }
+    static unsigned long long getFrameBytes(GlCallGroup) { return 0; }
+    static const char *getGroupName(GlCallGroup) { return ""; }
+    static void printReport() {}
+#endif
+};
+
+#endif
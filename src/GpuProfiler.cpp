@@ -0,0 +1,148 @@
+#include "GpuProfiler.h"
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+GpuProfiler::GpuProfiler() : passCount(0), depth(0), slot(0), frameCount(0), droppedFrames(0), frameSamples(0)
+{
+    glGenQueries(LATENCY * MAX_PASSES * 2, &queries[0][0][0]);
+    memset(issued, 0, sizeof(issued));
+    memset(passes, 0, sizeof(passes));
+
+    // pass 0 is always the whole frame
+    findOrAddPass("frame");
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    glDeleteQueries(LATENCY * MAX_PASSES * 2, &queries[0][0][0]);
+}
+
+void GpuProfiler::beginFrame()
+{
+    slot = frameCount % LATENCY;
+    collect(slot);
+    depth = 0;
+    beginPass("frame");
+}
+
+void GpuProfiler::endFrame()
+{
+    while (depth > 0)
+        endPass();
+    frameCount++;
+}
+
+void GpuProfiler::beginPass(const char *name)
+{
+    int index = findOrAddPass(name);
+    if (depth < MAX_DEPTH)
+        openPasses[depth] = index;
+    depth++; // counted even when untracked, to keep endPass() balanced
+
+    if (index >= 0 && depth <= MAX_DEPTH)
+        glQueryCounter(queries[slot][index][0], GL_TIMESTAMP);
+}
+
+void GpuProfiler::endPass()
+{
+    if (depth == 0)
+        return;
+    if (--depth >= MAX_DEPTH)
+        return;
+
+    int index = openPasses[depth];
+    if (index < 0)
+        return;
+
+    glQueryCounter(queries[slot][index][1], GL_TIMESTAMP);
+    issued[slot][index] = true;
+}
+
+const GpuProfiler::PassStats *GpuProfiler::findPass(const char *name) const
+{
+    for (int i = 0; i < passCount; ++i)
+    {
+        if (strcmp(passes[i].name, name) == 0)
+            return &passes[i];
+    }
+    return NULL;
+}
+
+void GpuProfiler::printStats() const
+{
+    std::cout << "GPU passes (ms over last " << WINDOW << " frames):" << std::endl;
+    for (int i = 0; i < passCount; ++i)
+    {
+        const PassStats &pass = passes[i];
+        std::cout << "  " << std::left << std::setw(10) << pass.name << std::right << std::fixed << std::setprecision(3)
+                  << " avg " << pass.avgMs << "  min " << pass.minMs << "  max " << pass.maxMs << std::endl;
+    }
+    if (droppedFrames)
+        std::cout << "  " << droppedFrames << " frames dropped (results not ready after " << LATENCY << " frames)" << std::endl;
+}
+
+int GpuProfiler::findOrAddPass(const char *name)
+{
+    for (int i = 0; i < passCount; ++i)
+    {
+        if (passes[i].name == name || strcmp(passes[i].name, name) == 0)
+            return i;
+    }
+    if (passCount == MAX_PASSES)
+        return -1;
+
+    passes[passCount].name = name;
+    return passCount++;
+}
+
+void GpuProfiler::collect(int s)
+{
+    // the frame pass ends last, so once it is available all others are too
+    if (!issued[s][0])
+        return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(queries[s][0][1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        // never wait, the slot is overwritten and these samples are lost
+        droppedFrames++;
+        memset(issued[s], 0, sizeof(issued[s]));
+        return;
+    }
+
+    for (int i = 0; i < passCount; ++i)
+    {
+        if (!issued[s][i])
+            continue;
+
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(queries[s][i][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(queries[s][i][1], GL_QUERY_RESULT, &end);
+        addSample(passes[i], (float)((end - begin) * 1.0e-6));
+        issued[s][i] = false;
+    }
+    frameSamples++;
+}
+
+void GpuProfiler::addSample(PassStats &pass, float ms)
+{
+    pass.lastMs = ms;
+    pass.samples[pass.next] = ms;
+    pass.next = (pass.next + 1) % WINDOW;
+    if (pass.count < WINDOW)
+        pass.count++;
+
+    float sum = 0.0f;
+    pass.minMs = pass.maxMs = pass.samples[0];
+    for (int i = 0; i < pass.count; ++i)
+    {
+        sum += pass.samples[i];
+        if (pass.samples[i] < pass.minMs)
+            pass.minMs = pass.samples[i];
+        if (pass.samples[i] > pass.maxMs)
+            pass.maxMs = pass.samples[i];
+    }
+    pass.avgMs = sum / pass.count;
+}
@@ -0,0 +1,62 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+#include <glad/glad.h>
+
+// GPU pass timing with GL_TIMESTAMP queries.
+// Every frame writes into its own slot of a ring of query objects and the slot is
+// only read back when the ring wraps around, LATENCY frames later, so reading the
+// results never waits for the GPU.
+class GpuProfiler
+{
+public:
+    static const int LATENCY = 4;     // frames between issuing and reading a query
+    static const int MAX_PASSES = 8;  // distinct pass names, "frame" included
+    static const int MAX_DEPTH = 4;   // nesting of open passes
+    static const int WINDOW = 120;    // samples kept for the rolling stats
+
+    struct PassStats
+    {
+        const char *name;
+        float samples[WINDOW]; // ms
+        int count;
+        int next;
+        float lastMs;
+        float avgMs;
+        float minMs;
+        float maxMs;
+    };
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    void beginFrame(); // reads back the slot being reused, then starts the "frame" pass
+    void endFrame();
+    void beginPass(const char *name); // name must outlive the profiler (string literal)
+    void endPass();
+
+    int getPassCount() const { return passCount; }
+    const PassStats &getPass(int index) const { return passes[index]; }
+    const PassStats *findPass(const char *name) const;
+    float getFrameMs() const { return passes[0].lastMs; }
+    unsigned int getFrameSamples() const { return frameSamples; } // changes when getFrameMs() has a new value
+    unsigned int getDroppedFrames() const { return droppedFrames; }
+    void printStats() const;
+
+private:
+    int findOrAddPass(const char *name);
+    void collect(int slot);
+    void addSample(PassStats &pass, float ms);
+
+    unsigned int queries[LATENCY][MAX_PASSES][2]; // begin/end timestamps
+    bool issued[LATENCY][MAX_PASSES];
+    PassStats passes[MAX_PASSES];
+    int passCount;
+    int openPasses[MAX_DEPTH];
+    int depth;
+    int slot;
+    unsigned int frameCount;
+    unsigned int droppedFrames;
+    unsigned int frameSamples;
+};
+
+#endif
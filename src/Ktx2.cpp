@@ -0,0 +1,326 @@
+#include "Ktx2.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const unsigned char IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// Khronos data format descriptor values
+static const unsigned char DF_MODEL_RGBSDA = 1;
+static const unsigned char DF_MODEL_BC1A = 128;
+static const unsigned char DF_MODEL_BC3 = 130;
+static const unsigned char DF_PRIMARIES_BT709 = 1;
+static const unsigned char DF_TRANSFER_LINEAR = 1;
+static const unsigned char DF_TRANSFER_SRGB = 2;
+static const unsigned char DF_CHANNEL_ALPHA = 15;
+static const unsigned char DF_SAMPLE_LINEAR = 1 << 4;
+
+// identifier, 13 32-bit and 2 64-bit header fields
+static const size_t HEADER_SIZE = 12 + 13 * 4 + 2 * 8;
+static const size_t LEVEL_INDEX_SIZE = 3 * 8;
+static const unsigned int MAX_LEVELS = 32;
+
+static unsigned int getU32(const unsigned char *in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((unsigned int)in[3] << 24);
+}
+
+static unsigned long long getU64(const unsigned char *in)
+{
+    return getU32(in) | ((unsigned long long)getU32(in + 4) << 32);
+}
+
+static void putU8(std::vector<unsigned char> &out, unsigned int value)
+{
+    out.push_back((unsigned char)value);
+}
+
+static void putU16(std::vector<unsigned char> &out, unsigned int value)
+{
+    putU8(out, value & 0xFF);
+    putU8(out, value >> 8);
+}
+
+static void putU32(std::vector<unsigned char> &out, unsigned int value)
+{
+    putU16(out, value & 0xFFFF);
+    putU16(out, value >> 16);
+}
+
+static void putU64(std::vector<unsigned char> &out, unsigned long long value)
+{
+    putU32(out, (unsigned int)value);
+    putU32(out, (unsigned int)(value >> 32));
+}
+
+static void putSample(std::vector<unsigned char> &out, int bitOffset, int bitLength, unsigned char channel, unsigned int upper)
+{
+    putU16(out, bitOffset);
+    putU8(out, bitLength - 1);
+    putU8(out, channel);
+    putU32(out, 0); // sample position
+    putU32(out, 0); // lower
+    putU32(out, upper);
+}
+
+static std::vector<unsigned char> makeDescriptor(unsigned int format)
+{
+    bool srgb = Ktx2::isSrgb(format);
+
+    std::vector<unsigned char> samples;
+    unsigned char model;
+    unsigned char dimensions = 0;
+    int bytesPlane0 = Ktx2::getBlockBytes(format);
+    if (format == KTX2_BC1_RGB_UNORM || format == KTX2_BC1_RGB_SRGB)
+    {
+        model = DF_MODEL_BC1A;
+        dimensions = 3;
+        putSample(samples, 0, 64, 0, 0xFFFFFFFF);
+    }
+    else if (format == KTX2_BC3_UNORM || format == KTX2_BC3_SRGB)
+    {
+        model = DF_MODEL_BC3;
+        dimensions = 3;
+        putSample(samples, 0, 64, DF_CHANNEL_ALPHA | (srgb ? DF_SAMPLE_LINEAR : 0), 0xFFFFFFFF);
+        putSample(samples, 64, 64, 0, 0xFFFFFFFF);
+    }
+    else
+    {
+        model = DF_MODEL_RGBSDA;
+        for (int channel = 0; channel < 3; ++channel)
+            putSample(samples, channel * 8, 8, channel, 255);
+        putSample(samples, 24, 8, DF_CHANNEL_ALPHA | (srgb ? DF_SAMPLE_LINEAR : 0), 255);
+    }
+
+    unsigned int blockSize = 24 + (unsigned int)samples.size();
+    std::vector<unsigned char> out;
+    putU32(out, 4 + blockSize); // dfdTotalSize
+    putU32(out, 0);             // vendor Khronos, basic descriptor
+    putU32(out, 2 | (blockSize << 16));
+    putU8(out, model);
+    putU8(out, DF_PRIMARIES_BT709);
+    putU8(out, srgb ? DF_TRANSFER_SRGB : DF_TRANSFER_LINEAR);
+    putU8(out, 0); // straight alpha
+    putU8(out, dimensions);
+    putU8(out, dimensions);
+    putU8(out, 0);
+    putU8(out, 0);
+    putU8(out, bytesPlane0);
+    for (int i = 1; i < 8; ++i)
+        putU8(out, 0);
+    out.insert(out.end(), samples.begin(), samples.end());
+    return out;
+}
+
+static size_t align(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool Ktx2::isCompressed(unsigned int format)
+{
+    return format == KTX2_BC1_RGB_UNORM || format == KTX2_BC1_RGB_SRGB || format == KTX2_BC3_UNORM || format == KTX2_BC3_SRGB;
+}
+
+bool Ktx2::isSrgb(unsigned int format)
+{
+    return format == KTX2_R8G8B8A8_SRGB || format == KTX2_BC1_RGB_SRGB || format == KTX2_BC3_SRGB;
+}
+
+int Ktx2::getBlockBytes(unsigned int format)
+{
+    switch (format)
+    {
+    case KTX2_BC1_RGB_UNORM:
+    case KTX2_BC1_RGB_SRGB:
+        return 8;
+    case KTX2_BC3_UNORM:
+    case KTX2_BC3_SRGB:
+        return 16;
+    case KTX2_R8G8B8A8_UNORM:
+    case KTX2_R8G8B8A8_SRGB:
+        return 4;
+    }
+    return 0;
+}
+
+size_t Ktx2::getLevelSize(unsigned int format, int width, int height)
+{
+    if (isCompressed(format))
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * getBlockBytes(format);
+    return (size_t)width * height * getBlockBytes(format);
+}
+
+bool Ktx2::write(const char *path, unsigned int format, const std::vector<std::vector<unsigned char>> &levels, int width, int height)
+{
+    std::vector<unsigned char> descriptor = makeDescriptor(format);
+
+    static const char key[] = "KTXorientation";
+    static const char value[] = "ru";
+    std::vector<unsigned char> keyValues;
+    putU32(keyValues, sizeof(key) + sizeof(value));
+    keyValues.insert(keyValues.end(), key, key + sizeof(key));
+    keyValues.insert(keyValues.end(), value, value + sizeof(value));
+    keyValues.resize(align(keyValues.size(), 4), 0);
+
+    size_t levelCount = levels.size();
+    size_t dfdOffset = align(HEADER_SIZE + LEVEL_INDEX_SIZE * levelCount, 4);
+    size_t kvdOffset = dfdOffset + descriptor.size();
+    size_t dataOffset = kvdOffset + keyValues.size();
+
+    // levels are stored smallest first, each aligned to lcm(block size, 4)
+    size_t alignment = getBlockBytes(format) % 4 == 0 ? getBlockBytes(format) : 4 * getBlockBytes(format);
+    std::vector<size_t> offsets(levelCount);
+    size_t end = dataOffset;
+    for (size_t i = levelCount; i-- > 0;)
+    {
+        offsets[i] = align(end, alignment);
+        end = offsets[i] + levels[i].size();
+    }
+
+    std::vector<unsigned char> out(IDENTIFIER, IDENTIFIER + sizeof(IDENTIFIER));
+    putU32(out, format);
+    putU32(out, 1); // type size: bytes per component, 1 for block formats too
+    putU32(out, width);
+    putU32(out, height);
+    putU32(out, 0); // depth
+    putU32(out, 0); // layers
+    putU32(out, 1); // faces
+    putU32(out, (unsigned int)levelCount);
+    putU32(out, 0); // no supercompression
+    putU32(out, (unsigned int)dfdOffset);
+    putU32(out, (unsigned int)descriptor.size());
+    putU32(out, (unsigned int)kvdOffset);
+    putU32(out, (unsigned int)keyValues.size());
+    putU64(out, 0);
+    putU64(out, 0);
+    for (size_t i = 0; i < levelCount; ++i)
+    {
+        putU64(out, offsets[i]);
+        putU64(out, levels[i].size());
+        putU64(out, levels[i].size());
+    }
+    out.resize(dfdOffset, 0);
+    out.insert(out.end(), descriptor.begin(), descriptor.end());
+    out.insert(out.end(), keyValues.begin(), keyValues.end());
+    for (size_t i = levelCount; i-- > 0;)
+    {
+        out.resize(offsets[i], 0);
+        out.insert(out.end(), levels[i].begin(), levels[i].end());
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        std::cout << "Failed to write KTX2 file: " << path << std::endl;
+        return false;
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    fclose(file);
+    return ok;
+}
+
+// checks the header and level index at the start of in; offsets are checked against the file size
+static bool parse(const char *path, const unsigned char *in, size_t available, size_t fileSize, Ktx2Image &image)
+{
+    if (available < HEADER_SIZE || memcmp(in, IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+    {
+        std::cout << "Not a KTX2 file: " << path << std::endl;
+        return false;
+    }
+
+    unsigned int format = getU32(in + 12);
+    unsigned int width = getU32(in + 20);
+    unsigned int height = getU32(in + 24);
+    unsigned int depth = getU32(in + 28);
+    unsigned int layerCount = getU32(in + 32);
+    unsigned int faceCount = getU32(in + 36);
+    unsigned int levelCount = getU32(in + 40);
+    unsigned int supercompression = getU32(in + 44);
+    if (!Ktx2::getBlockBytes(format) || supercompression != 0 || depth > 1 || layerCount > 1 || faceCount != 1 || levelCount == 0 ||
+        levelCount > MAX_LEVELS || width == 0 || height == 0)
+    {
+        std::cout << "Unsupported KTX2 file: " << path << std::endl;
+        return false;
+    }
+
+    if (available < HEADER_SIZE + levelCount * LEVEL_INDEX_SIZE)
+    {
+        std::cout << "Truncated KTX2 file: " << path << std::endl;
+        return false;
+    }
+
+    image.format = format;
+    image.width = width;
+    image.height = height;
+    image.levels.resize(levelCount);
+    for (unsigned int i = 0; i < levelCount; ++i)
+    {
+        const unsigned char *index = in + HEADER_SIZE + i * LEVEL_INDEX_SIZE;
+        Ktx2Level &level = image.levels[i];
+        level.offset = getU64(index);
+        level.size = getU64(index + 8);
+        level.width = width >> i ? width >> i : 1;
+        level.height = height >> i ? height >> i : 1;
+        if (level.offset + level.size > fileSize || level.size < Ktx2::getLevelSize(format, level.width, level.height))
+        {
+            std::cout << "Truncated KTX2 file: " << path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Ktx2::read(const char *path, Ktx2Image &image)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    image.data.resize(size > 0 ? size : 0);
+    bool ok = size > 0 && fread(image.data.data(), 1, size, file) == (size_t)size;
+    fclose(file);
+
+    if (!ok)
+    {
+        std::cout << "Not a KTX2 file: " << path << std::endl;
+        return false;
+    }
+    return parse(path, image.data.data(), image.data.size(), image.data.size(), image);
+}
+
+bool Ktx2::readHeader(const char *path, Ktx2Image &image)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // the level index follows the header, a full one is only a few hundred bytes
+    unsigned char in[HEADER_SIZE + MAX_LEVELS * LEVEL_INDEX_SIZE];
+    size_t available = size > 0 ? fread(in, 1, sizeof(in), file) : 0;
+    fclose(file);
+
+    image.data.clear();
+    return parse(path, in, available, size > 0 ? size : 0, image);
+}
+
+bool Ktx2::readMemory(const char *name, const unsigned char *data, size_t size, Ktx2Image &image)
+{
+    image.data.clear();
+    return parse(name, data, size, size, image);
+}
+
+bool Ktx2::readLevel(const char *path, const Ktx2Level &level, unsigned char *data)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    bool ok = fseek(file, (long)level.offset, SEEK_SET) == 0 && fread(data, 1, level.size, file) == level.size;
+    fclose(file);
+    return ok;
+}
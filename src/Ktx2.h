@@ -0,0 +1,54 @@
+#ifndef KTX2_H
+#define KTX2_H
+#include <cstddef>
+#include <vector>
+
+// Vulkan format numbers used in KTX2 headers
+enum Ktx2Format
+{
+    KTX2_R8G8B8A8_UNORM = 37,
+    KTX2_R8G8B8A8_SRGB = 43,
+    KTX2_BC1_RGB_UNORM = 131,
+    KTX2_BC1_RGB_SRGB = 132,
+    KTX2_BC3_UNORM = 137,
+    KTX2_BC3_SRGB = 138
+};
+
+struct Ktx2Level
+{
+    size_t offset; // into the file, which is Ktx2Image::data when read whole
+    size_t size;
+    int width;
+    int height;
+};
+
+struct Ktx2Image
+{
+    unsigned int format; // Ktx2Format
+    int width;
+    int height;
+    std::vector<Ktx2Level> levels; // level 0 is the full size image
+    std::vector<unsigned char> data;
+};
+
+// Minimal KTX 2.0 reader and writer: single 2D images with a mip chain, no
+// supercompression, in the formats above. Rows are stored bottom-up, as GL
+// expects them (KTXorientation "ru").
+class Ktx2
+{
+public:
+    static bool read(const char *path, Ktx2Image &image);
+    static bool readHeader(const char *path, Ktx2Image &image); // the levels, without their data
+    static bool readLevel(const char *path, const Ktx2Level &level, unsigned char *data); // level.size bytes
+    // a file already in memory: the levels' offsets are into data, image.data is left empty
+    static bool readMemory(const char *name, const unsigned char *data, size_t size, Ktx2Image &image);
+    static bool write(const char *path, unsigned int format, const std::vector<std::vector<unsigned char>> &levels, int width,
+                      int height);
+
+    static bool isCompressed(unsigned int format);
+    static bool isSrgb(unsigned int format);
+    static int getBlockBytes(unsigned int format); // per 4x4 block, or per texel when uncompressed
+    static size_t getLevelSize(unsigned int format, int width, int height);
+};
+
+#endif
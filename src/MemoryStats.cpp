@@ -0,0 +1,235 @@
+#include "MemoryStats.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+static std::atomic<long long> cpuBytes[MEM_TAG_COUNT];
+static std::atomic<long long> gpuBytes[MEM_TAG_COUNT];
+static std::atomic<long long> peakCpuBytes[MEM_TAG_COUNT];
+static std::atomic<long long> peakGpuBytes[MEM_TAG_COUNT];
+
+static std::atomic<unsigned long long> allocationCount(0);
+static std::atomic<unsigned long long> allocatedBytes(0);
+static thread_local unsigned long long threadAllocations = 0; // constant initialized, safe in operator new
+
+// GL name and tag -> bytes
+static std::mutex gpuObjectsMutex;
+static std::unordered_map<unsigned long long, long long> gpuObjects;
+
+// main loop only
+static unsigned long long frameStartCount = 0; // the main loop thread's
+static unsigned long long frameStartTotal = 0; // all threads'
+static unsigned long long workerAllocations = 0;
+static unsigned long long frameCount = 0;
+static unsigned long long allocatingFrames = 0;
+static unsigned long long maxFrameAllocations = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// allocation hook, replaces the global operator new/delete
+///////////////////////////////////////////////////////////////////////////////
+void *operator new(size_t size)
+{
+    MemoryStats::countAllocation(size);
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+// out of line: GCC -O2 warns about a free() of new'd memory once the
+// deletes are inlined into their callers (-Wmismatched-new-delete)
+__attribute__((noinline)) static void release(void *ptr)
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    release(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    release(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    release(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    release(ptr);
+}
+
+static void add(std::atomic<long long> *current, std::atomic<long long> *peak, MemoryTag tag, long long bytes)
+{
+    long long value = current[tag].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    long long previous = peak[tag].load(std::memory_order_relaxed);
+    while (value > previous && !peak[tag].compare_exchange_weak(previous, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void MemoryStats::addCpu(MemoryTag tag, long long bytes)
+{
+    add(cpuBytes, peakCpuBytes, tag, bytes);
+}
+
+void MemoryStats::addGpu(MemoryTag tag, long long bytes)
+{
+    add(gpuBytes, peakGpuBytes, tag, bytes);
+}
+
+void MemoryStats::trackGpu(MemoryTag tag, unsigned int name, long long bytes)
+{
+    if (!name)
+        return;
+
+    std::lock_guard<std::mutex> lock(gpuObjectsMutex);
+    long long &tracked = gpuObjects[((unsigned long long)tag << 32) | name];
+    addGpu(tag, bytes - tracked);
+    tracked = bytes;
+}
+
+void MemoryStats::untrackGpu(MemoryTag tag, unsigned int name)
+{
+    std::lock_guard<std::mutex> lock(gpuObjectsMutex);
+    auto it = gpuObjects.find(((unsigned long long)tag << 32) | name);
+    if (it == gpuObjects.end())
+        return;
+
+    addGpu(tag, -it->second);
+    gpuObjects.erase(it);
+}
+
+long long MemoryStats::getCpuBytes(MemoryTag tag)
+{
+    return cpuBytes[tag].load(std::memory_order_relaxed);
+}
+
+long long MemoryStats::getGpuBytes(MemoryTag tag)
+{
+    return gpuBytes[tag].load(std::memory_order_relaxed);
+}
+
+long long MemoryStats::getPeakCpuBytes(MemoryTag tag)
+{
+    return peakCpuBytes[tag].load(std::memory_order_relaxed);
+}
+
+long long MemoryStats::getPeakGpuBytes(MemoryTag tag)
+{
+    return peakGpuBytes[tag].load(std::memory_order_relaxed);
+}
+
+const char *MemoryStats::getTagName(MemoryTag tag)
+{
+    static const char *names[MEM_TAG_COUNT] = {"mesh", "texture", "shader", "sim", "target", "transient"};
+    return tag < MEM_TAG_COUNT ? names[tag] : "unknown";
+}
+
+void MemoryStats::countAllocation(size_t bytes)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    threadAllocations++;
+}
+
+unsigned long long MemoryStats::getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+unsigned long long MemoryStats::getAllocatedBytes()
+{
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+void MemoryStats::beginFrame()
+{
+    frameStartCount = threadAllocations;
+    frameStartTotal = getAllocationCount();
+}
+
+void MemoryStats::endFrame()
+{
+    // texture workers and the like allocate whenever they have work, not per frame
+    unsigned long long allocations = threadAllocations - frameStartCount;
+    workerAllocations += getAllocationCount() - frameStartTotal - allocations;
+    frameCount++;
+    if (allocations)
+        allocatingFrames++;
+    if (allocations > maxFrameAllocations)
+        maxFrameAllocations = allocations;
+}
+
+void MemoryStats::resetFrames()
+{
+    frameCount = 0;
+    allocatingFrames = 0;
+    maxFrameAllocations = 0;
+    workerAllocations = 0;
+}
+
+unsigned long long MemoryStats::getFrameCount()
+{
+    return frameCount;
+}
+
+unsigned long long MemoryStats::getAllocatingFrames()
+{
+    return allocatingFrames;
+}
+
+unsigned long long MemoryStats::getMaxFrameAllocations()
+{
+    return maxFrameAllocations;
+}
+
+unsigned long long MemoryStats::getWorkerAllocations()
+{
+    return workerAllocations;
+}
+
+void MemoryStats::printReport()
+{
+    std::cout << "Memory (KB):        cpu      peak       gpu      peak" << std::endl;
+    for (int i = 0; i < MEM_TAG_COUNT; ++i)
+    {
+        MemoryTag tag = (MemoryTag)i;
+        std::cout << "  " << std::left << std::setw(10) << getTagName(tag) << std::right
+                  << std::setw(10) << getCpuBytes(tag) / 1024 << std::setw(10) << getPeakCpuBytes(tag) / 1024
+                  << std::setw(10) << getGpuBytes(tag) / 1024 << std::setw(10) << getPeakGpuBytes(tag) / 1024 << std::endl;
+    }
+    std::cout << "  heap: " << getAllocationCount() << " allocations, " << getAllocatedBytes() / 1024 << " KB" << std::endl;
+    std::cout << "  main loop: " << getAllocatingFrames() << " of " << getFrameCount()
+              << " frames allocated, at most " << getMaxFrameAllocations() << " allocations per frame" << std::endl;
+    std::cout << "  other threads meanwhile: " << getWorkerAllocations() << " allocations" << std::endl;
+}
+
+void MemoryStats::writeJson(FILE *file, const char *indent)
+{
+    for (int i = 0; i < MEM_TAG_COUNT; ++i)
+    {
+        MemoryTag tag = (MemoryTag)i;
+        fprintf(file, "%s\"%s\": {\"cpu_bytes\": %lld, \"peak_cpu_bytes\": %lld, \"gpu_bytes\": %lld, \"peak_gpu_bytes\": %lld},\n",
+                indent, getTagName(tag), getCpuBytes(tag), getPeakCpuBytes(tag), getGpuBytes(tag), getPeakGpuBytes(tag));
+    }
+    fprintf(file, "%s\"heap_allocations\": %llu,\n", indent, getAllocationCount());
+    fprintf(file, "%s\"heap_allocated_bytes\": %llu,\n", indent, getAllocatedBytes());
+    fprintf(file, "%s\"frames\": %llu,\n", indent, getFrameCount());
+    fprintf(file, "%s\"allocating_frames\": %llu,\n", indent, getAllocatingFrames());
+    fprintf(file, "%s\"max_frame_allocations\": %llu,\n", indent, getMaxFrameAllocations());
+    fprintf(file, "%s\"worker_allocations\": %llu\n", indent, getWorkerAllocations());
+}
@@ -0,0 +1,53 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+#include <cstdio>
+
+enum MemoryTag
+{
+    MEM_MESH,      // vertex/index data
+    MEM_TEXTURE,   // texture maps, mip chains included
+    MEM_SHADER,    // shader sources while compiling
+    MEM_SIM,       // Planet objects
+    MEM_TARGET,    // render targets (DepthTarget)
+    MEM_TRANSIENT, // decode buffers and other short lived data
+    MEM_TAG_COUNT
+};
+
+// Tagged CPU/GPU memory counters and a global operator new hook.
+// GPU sizes are what we asked the driver for, not what it really allocated.
+class MemoryStats
+{
+public:
+    static void addCpu(MemoryTag tag, long long bytes); // negative when freed
+    static void addGpu(MemoryTag tag, long long bytes);
+
+    // GPU objects by GL name, so they can be released without knowing their size
+    static void trackGpu(MemoryTag tag, unsigned int name, long long bytes);
+    static void untrackGpu(MemoryTag tag, unsigned int name);
+
+    static long long getCpuBytes(MemoryTag tag);
+    static long long getGpuBytes(MemoryTag tag);
+    static long long getPeakCpuBytes(MemoryTag tag);
+    static long long getPeakGpuBytes(MemoryTag tag);
+    static const char *getTagName(MemoryTag tag);
+
+    // every operator new in the process, and stb_image's mallocs (stb_image.cpp)
+    static void countAllocation(size_t bytes);
+    static unsigned long long getAllocationCount();
+    static unsigned long long getAllocatedBytes();
+
+    // per-frame heap allocations of the main loop, counted on the thread that
+    // calls beginFrame(); other threads' allocations meanwhile are kept apart
+    static void beginFrame();
+    static void endFrame();
+    static void resetFrames(); // e.g. after warmup
+    static unsigned long long getFrameCount();
+    static unsigned long long getAllocatingFrames(); // frames that allocated at all
+    static unsigned long long getMaxFrameAllocations();
+    static unsigned long long getWorkerAllocations(); // by other threads during the frames
+
+    static void printReport();
+    static void writeJson(FILE *file, const char *indent); // object body, for other reports
+};
+
+#endif
@@ -1,7 +1,10 @@
 #include "ModernSphere.h"
+#include "MemoryStats.h"
+#include "Profiler.h"
+#include "Probes.h"
 #include <iostream>
 
-ModernSphere::ModernSphere(const Sphere &sphere)
+ModernSphere::ModernSphere(const Sphere &sphere) : procedural(false), sectorCount(0), stackCount(0), drawCalls(0), trianglesDrawn(0)
 {
     const float *vertices = sphere.getInterleavedVertices();
     const unsigned int *indices = sphere.getIndices();
@@ -13,11 +16,18 @@ ModernSphere::ModernSphere(const Sphere &sphere)
 
     glBindVertexArray(VAO);
 
+    long long uploadStart = Profiler::now();
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sphere.getInterleavedVertexSize(), vertices, GL_STATIC_DRAW);
+    PROBE3(buffer_upload, VBO, sphere.getInterleavedVertexSize(), Profiler::now() - uploadStart);
 
+    uploadStart = Profiler::now();
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere.getIndexSize(), indices, GL_STATIC_DRAW);
+    PROBE3(buffer_upload, EBO, sphere.getIndexSize(), Profiler::now() - uploadStart);
+
+    MemoryStats::trackGpu(MEM_MESH, VBO, sphere.getInterleavedVertexSize());
+    MemoryStats::trackGpu(MEM_MESH, EBO, sphere.getIndexSize());
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sphere.getInterleavedStride(), (void *)0);
     glEnableVertexAttribArray(0);
@@ -33,16 +43,55 @@ ModernSphere::ModernSphere(const Sphere &sphere)
     std::cout << "Created modern sphere with " << indexCount << " indices" << std::endl;
 }
 
+ModernSphere::ModernSphere(int sectors, int stacks) : VBO(0), EBO(0), procedural(true), drawCalls(0), trianglesDrawn(0)
+{
+    // same limits as Sphere
+    sectorCount = sectors < 2 ? 2 : sectors;
+    stackCount = stacks < 2 ? 2 : stacks;
+
+    // 2 triangles per sector/stack quad; the ones touching the poles are degenerate
+    indexCount = sectorCount * stackCount * 6;
+
+    // core profile still needs a VAO bound to draw, even with no attributes
+    glGenVertexArrays(1, &VAO);
+
+    std::cout << "Created procedural sphere with " << indexCount << " vertices" << std::endl;
+}
+
 ModernSphere::~ModernSphere()
 {
     glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    if (!procedural)
+    {
+        MemoryStats::untrackGpu(MEM_MESH, VBO);
+        MemoryStats::untrackGpu(MEM_MESH, EBO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+}
+
+void ModernSphere::setUniforms(const Shader &shader) const
+{
+    shader.setBool("procedural", procedural);
+    shader.setInt("sectorCount", sectorCount);
+    shader.setInt("stackCount", stackCount);
 }
 
 void ModernSphere::draw() const
 {
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    if (procedural)
+        glDrawArrays(GL_TRIANGLES, 0, indexCount);
+    else
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
-}
\ No newline at end of file
+
+    drawCalls++;
+    trianglesDrawn += indexCount / 3;
+}
+
+void ModernSphere::resetCounters()
+{
+    drawCalls = 0;
+    trianglesDrawn = 0;
+}
@@ -3,18 +3,35 @@
 #include <glad/glad.h>
 #include <vector>
 #include "Sphere.h"
+#include "Shader.h"
 
 class ModernSphere
 {
 public:
+    // upload the vertex and index arrays built on the CPU
     ModernSphere(const Sphere &sphere);
+    // procedural mode: no vertex data, the vertex shader builds the sphere from gl_VertexID
+    ModernSphere(int sectorCount, int stackCount);
     ~ModernSphere();
 
+    void setUniforms(const Shader &shader) const;
     void draw() const;
 
+    bool isProcedural() const { return procedural; }
+
+    // draw counters, since the last resetCounters()
+    unsigned int getDrawCalls() const { return drawCalls; }
+    unsigned long long getTrianglesDrawn() const { return trianglesDrawn; }
+    void resetCounters();
+
 private:
     unsigned int VAO, VBO, EBO;
     unsigned int indexCount;
+    bool procedural;
+    int sectorCount; // procedural mode only
+    int stackCount;  // procedural mode only
+    mutable unsigned int drawCalls;
+    mutable unsigned long long trianglesDrawn;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,152 @@
+#include "PageFile.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <iostream>
+
+static const unsigned char MAGIC[4] = {'S', 'V', 'T', 'X'};
+static const unsigned int VERSION = 1;
+static const int HEADER_SIZE = 7 * 4;
+
+static bool isPowerOfTwo(int value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+PageFile::PageFile() : fd(-1), width(0), height(0), levelCount(0)
+{
+}
+
+PageFile::~PageFile()
+{
+    close();
+}
+
+int PageFile::getLevelCount(int width, int height)
+{
+    int levels = 1;
+    while (width > TILE_SIZE || height > TILE_SIZE)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+bool PageFile::open(const char *path)
+{
+    close();
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    unsigned int header[7];
+    if (pread(fd, header, HEADER_SIZE, 0) != HEADER_SIZE || memcmp(header, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        std::cout << "Not a page file: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    width = (int)header[2];
+    height = (int)header[3];
+    levelCount = (int)header[6];
+    if (header[1] != VERSION || header[4] != TILE_SIZE || header[5] != BORDER || !isPowerOfTwo(width) || !isPowerOfTwo(height) ||
+        levelCount != getLevelCount(width, height))
+    {
+        std::cout << "Unsupported page file: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size < getTileOffset(levelCount, 0, 0))
+    {
+        std::cout << "Truncated page file: " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool PageFile::create(const char *path, int w, int h)
+{
+    close();
+    if (!isPowerOfTwo(w) || !isPowerOfTwo(h))
+    {
+        std::cout << "Page file sizes must be powers of two: " << w << "x" << h << std::endl;
+        return false;
+    }
+
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        std::cout << "Failed to create page file: " << path << std::endl;
+        return false;
+    }
+
+    width = w;
+    height = h;
+    levelCount = getLevelCount(w, h);
+    unsigned int header[7];
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    header[1] = VERSION;
+    header[2] = width;
+    header[3] = height;
+    header[4] = TILE_SIZE;
+    header[5] = BORDER;
+    header[6] = levelCount;
+    if (pwrite(fd, header, HEADER_SIZE, 0) != HEADER_SIZE)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void PageFile::close()
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    width = height = levelCount = 0;
+}
+
+int PageFile::getTilesX(int level) const
+{
+    int levelWidth = width >> level ? width >> level : 1;
+    return (levelWidth + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+int PageFile::getTilesY(int level) const
+{
+    int levelHeight = height >> level ? height >> level : 1;
+    return (levelHeight + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+long long PageFile::getTileOffset(int level, int x, int y) const
+{
+    long long tiles = 0;
+    for (int i = 0; i < level; ++i)
+        tiles += (long long)getTilesX(i) * getTilesY(i);
+    if (level < levelCount)
+        tiles += (long long)y * getTilesX(level) + x;
+    return HEADER_SIZE + tiles * TILE_BYTES;
+}
+
+bool PageFile::readTile(int level, int x, int y, std::vector<unsigned char> &data) const
+{
+    data.resize(TILE_BYTES);
+    if (fd < 0 || pread(fd, data.data(), TILE_BYTES, getTileOffset(level, x, y)) != TILE_BYTES)
+    {
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+bool PageFile::writeTile(int level, int x, int y, const unsigned char *data)
+{
+    return fd >= 0 && pwrite(fd, data, TILE_BYTES, getTileOffset(level, x, y)) == TILE_BYTES;
+}
@@ -0,0 +1,49 @@
+#ifndef PAGE_FILE_H
+#define PAGE_FILE_H
+#include <vector>
+
+// Tiled mip chain of one very large RGBA8 image, read a tile at a time by the
+// virtual texture cache. Level 0 is a power of two in each direction; every
+// level is cut into TILE_SIZE tiles, each stored with a BORDER of texels
+// copied from its neighbours (wrapping left/right, clamped top/bottom) so it
+// can be filtered on its own. Rows are bottom-up, as GL expects them.
+//
+//   header: 'SVTX', version, width, height, tile size, border, level count (u32 each)
+//   tiles:  level 0 first, then row by row, TILE_STRIDE^2 RGBA8 texels each
+class PageFile
+{
+public:
+    static const int TILE_SIZE = 128;
+    static const int BORDER = 4;
+    static const int TILE_STRIDE = TILE_SIZE + 2 * BORDER;
+    static const int TILE_BYTES = TILE_STRIDE * TILE_STRIDE * 4;
+
+    PageFile();
+    ~PageFile();
+
+    bool open(const char *path); // false, quietly, if there is no such file
+    bool create(const char *path, int width, int height);
+    void close();
+
+    // thread safe: pread/pwrite at the tile's offset
+    bool readTile(int level, int x, int y, std::vector<unsigned char> &data) const;
+    bool writeTile(int level, int x, int y, const unsigned char *data);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getLevelCount() const { return levelCount; }
+    int getTilesX(int level) const;
+    int getTilesY(int level) const;
+
+    static int getLevelCount(int width, int height); // down to the level that fits in one tile
+
+private:
+    long long getTileOffset(int level, int x, int y) const;
+
+    int fd;
+    int width;
+    int height;
+    int levelCount;
+};
+
+#endif
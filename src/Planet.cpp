@@ -1,8 +1,9 @@
 #include "Planet.h"
-#include <stb_image.h>
+#include "Profiler.h"
+#include "MemoryStats.h"
 #include <iostream>
 
-Planet::Planet(float radius, float orbSpeed, float rotSpeed, float size, const char *texturePath)
+Planet::Planet(float radius, float orbSpeed, float rotSpeed, float size, Texture *texture)
 {
     orbitRadius = radius;
     orbitSpeed = orbSpeed;
@@ -11,13 +12,15 @@ Planet::Planet(float radius, float orbSpeed, float rotSpeed, float size, const c
     orbitAngle = 0.0f;
     rotationAngle = 0.0f;
     position = glm::vec3(radius, 0.0f, 0.0f);
+    this->texture = texture;
+    virtualTexture = NULL;
 
-    loadTexture(texturePath);
+    MemoryStats::addCpu(MEM_SIM, sizeof(Planet));
 }
 
 Planet::~Planet()
 {
-    glDeleteTextures(1, &textureID);
+    MemoryStats::addCpu(MEM_SIM, -(long long)(sizeof(Planet) + moons.capacity() * sizeof(Planet *)));
 
     for (auto moon : moons)
     {
@@ -27,6 +30,8 @@ Planet::~Planet()
 
 void Planet::update(float deltaTime)
 {
+    PROFILE_SCOPE("Planet::update");
+
     orbitAngle += orbitSpeed * deltaTime;
     if (orbitAngle > 360.0f)
         orbitAngle -= 360.0f;
@@ -41,7 +46,17 @@ void Planet::update(float deltaTime)
     updateMoons(deltaTime);
 }
 
-void Planet::render(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection)
+void Planet::render(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection, const Frustum *frustum)
+{
+    PROFILE_SCOPE("Planet::render");
+
+    if (!frustum || isVisible(*frustum))
+        draw(shader, sphere, view, projection);
+
+    renderMoons(shader, sphere, view, projection, frustum);
+}
+
+void Planet::draw(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection)
 {
     shader.use();
 
@@ -49,13 +64,46 @@ void Planet::render(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::m
     shader.setMat4("view", view);
     shader.setMat4("projection", projection);
 
+    // a virtual texture replaces the map, which then never needs loading
+    if (texture && !virtualTexture)
+    {
+        // projected diameter over the viewport height, picks the mips to stream
+        float distance = glm::length(glm::vec3(view * glm::vec4(position, 1.0f)));
+        texture->request(distance > scale ? scale * projection[1][1] / distance : 1.0f);
+    }
+
+    if (virtualTexture)
+        virtualTexture->setUniforms(shader);
+    else
+        shader.setBool("virtualTexture", false);
+
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    // the placeholder while the texture is still loading
+    glBindTexture(GL_TEXTURE_2D, texture ? texture->getId() : 0);
     shader.setInt("texture1", 0);
 
     sphere.draw();
+}
 
-    renderMoons(shader, sphere, view, projection);
+void Planet::renderFeedback(Shader &shader, ModernSphere &sphere, const Frustum &frustum)
+{
+    if (virtualTexture && isVisible(frustum))
+    {
+        shader.setMat4("model", getModelMatrix());
+        virtualTexture->setUniforms(shader);
+        sphere.draw();
+    }
+
+    for (auto moon : moons)
+    {
+        moon->renderFeedback(shader, sphere, frustum);
+    }
+}
+
+bool Planet::isVisible(const Frustum &frustum) const
+{
+    // the sphere mesh has radius 1, scaled by the model matrix
+    return frustum.intersectsSphere(position, scale);
 }
 
 glm::mat4 Planet::getModelMatrix()
@@ -85,45 +133,11 @@ void Planet::adjustOrbitSpeed(float amount)
         orbitSpeed = 0.0f;
 }
 
-void Planet::loadTexture(const char *texturePath)
-{
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-
-    unsigned char *data = stbi_load(texturePath, &width, &height, &nrChannels, 0);
-
-    if (data)
-    {
-        GLenum format;
-        if (nrChannels == 1)
-            format = GL_RED;
-        else if (nrChannels == 3)
-            format = GL_RGB;
-        else if (nrChannels == 4)
-            format = GL_RGBA;
-
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cout << "Failed to load texture: " << texturePath << std::endl;
-    }
-
-    stbi_image_free(data);
-}
-
 void Planet::addMoon(Planet *moon)
 {
+    size_t capacity = moons.capacity();
     moons.push_back(moon);
+    MemoryStats::addCpu(MEM_SIM, (long long)(moons.capacity() - capacity) * sizeof(Planet *));
 }
 
 void Planet::updateMoons(float deltaTime)
@@ -146,10 +160,10 @@ void Planet::updateMoons(float deltaTime)
     }
 }
 
-void Planet::renderMoons(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection)
+void Planet::renderMoons(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection, const Frustum *frustum)
 {
     for (auto moon : moons)
     {
-        moon->render(shader, sphere, view, projection);
+        moon->render(shader, sphere, view, projection, frustum);
     }
 }
\ No newline at end of file
@@ -8,6 +8,9 @@
 #include <string>
 #include "Shader.h"
 #include "ModernSphere.h"
+#include "Frustum.h"
+#include "TextureManager.h"
+#include "VirtualTexture.h"
 
 class Planet
 {
@@ -19,23 +22,27 @@ public:
     float scale;
     float orbitAngle;
     float rotationAngle;
-    unsigned int textureID;
+    Texture *texture; // owned by the TextureManager, NULL for untextured bodies
+    VirtualTexture *virtualTexture; // used instead of texture when set, owned by the VirtualTextureCache
     std::vector<Planet *> moons;
 
-    Planet(float radius, float orbSpeed, float rotSpeed, float size, const char *texturePath);
+    Planet(float radius, float orbSpeed, float rotSpeed, float size, Texture *texture);
     ~Planet();
 
     void update(float deltaTime);
-    void render(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection);
+    // bodies outside the frustum (if given) are skipped, their moons are tested on their own
+    void render(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection, const Frustum *frustum = NULL);
+    // this body alone, not culled and without its moons
+    void draw(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection);
+    // the virtual texture feedback pass, for bodies with a virtual texture
+    void renderFeedback(Shader &shader, ModernSphere &sphere, const Frustum &frustum);
+    bool isVisible(const Frustum &frustum) const;
     void adjustRotationSpeed(float amount);
     void adjustOrbitSpeed(float amount);
     glm::mat4 getModelMatrix();
     void addMoon(Planet *moon);
     void updateMoons(float deltaTime);
-    void renderMoons(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection);
-
-private:
-    void loadTexture(const char *texturePath);
+    void renderMoons(Shader &shader, ModernSphere &sphere, glm::mat4 view, glm::mat4 projection, const Frustum *frustum = NULL);
 };
 
 #endif
\ No newline at end of file
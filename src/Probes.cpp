@@ -0,0 +1,11 @@
+#include "Probes.h"
+
+#ifdef SOLAR_PROBES_ENABLED
+// raised by tracers while they are attached to the probe, see PROBE_ENABLED
+PROBE_SEMAPHORE(frame_begin) = 0;
+PROBE_SEMAPHORE(frame_end) = 0;
+PROBE_SEMAPHORE(sim_step) = 0;
+PROBE_SEMAPHORE(texture_upload) = 0;
+PROBE_SEMAPHORE(shader_compile) = 0;
+PROBE_SEMAPHORE(buffer_upload) = 0;
+#endif
@@ -0,0 +1,54 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT static tracepoints, provider "solar_system", for perf, bpftrace and SystemTap:
+//
+//   bpftrace -e 'usdt:./solar-system:solar_system:frame_end { @frame_us = hist(arg1 / 1000); }'
+//   perf probe -x ./solar-system sdt_solar_system:texture_upload
+//
+// A probe is a single nop plus an ELF note until a tracer attaches to it. Arguments
+// are integers and pointers only, times are in ns. Without <sys/sdt.h>
+// (systemtap-sdt-dev) or with SOLAR_NO_PROBES defined the probes compile to nothing
+// and their arguments are not evaluated. Arguments that cost something to
+// compute, like a time measured just for the probe, go under PROBE_ENABLED(name),
+// which reads the semaphore tracers raise while attached (Probes.cpp).
+//
+//   frame_begin    (frame)
+//   frame_end      (frame, frame_ns, cpu_ns, present_ns)
+//   sim_step       (frame, bodies, ns)         after the simulation step
+//   texture_upload (texture, width, height, bytes, ns)
+//   shader_compile (vertex_path, fragment_path, program, ns)
+//   buffer_upload  (buffer, bytes, ns)
+
+#if defined(__has_include) && !defined(SOLAR_NO_PROBES)
+#if __has_include(<sys/sdt.h>)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define SOLAR_PROBES_ENABLED 1
+#endif
+#endif
+
+#ifdef SOLAR_PROBES_ENABLED
+// with _SDT_HAS_SEMAPHORES every probe refers to its semaphore
+#define PROBE_SEMAPHORE(name) unsigned short solar_system_##name##_semaphore __attribute__((unused, section(".probes")))
+extern PROBE_SEMAPHORE(frame_begin);
+extern PROBE_SEMAPHORE(frame_end);
+extern PROBE_SEMAPHORE(sim_step);
+extern PROBE_SEMAPHORE(texture_upload);
+extern PROBE_SEMAPHORE(shader_compile);
+extern PROBE_SEMAPHORE(buffer_upload);
+
+#define PROBE_ENABLED(name) __builtin_expect(solar_system_##name##_semaphore != 0, 0)
+#define PROBE1(name, a) DTRACE_PROBE1(solar_system, name, a)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(solar_system, name, a, b, c)
+#define PROBE4(name, a, b, c, d) DTRACE_PROBE4(solar_system, name, a, b, c, d)
+#define PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(solar_system, name, a, b, c, d, e)
+#else
+#define PROBE_ENABLED(name) false
+#define PROBE1(name, a) do { (void)sizeof(a); } while (0)
+#define PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#define PROBE4(name, a, b, c, d) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); } while (0)
+#define PROBE5(name, a, b, c, d, e) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); (void)sizeof(e); } while (0)
+#endif
+
+#endif
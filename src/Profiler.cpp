@@ -0,0 +1,168 @@
+#include "Profiler.h"
+#include "Timer.h"
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    const unsigned long long NO_EVENT = ~0ULL;
+
+    // an event that writeChromeTrace() may read while its owner overwrites it:
+    // index is the event's number, NO_EVENT while it is being written
+    struct Slot
+    {
+        std::atomic<unsigned long long> index;
+        std::atomic<const char *> name;
+        std::atomic<long long> start;
+        std::atomic<long long> duration;
+    };
+
+    // one per thread, written only by its owner
+    struct ThreadBuffer
+    {
+        Slot events[Profiler::CAPACITY];
+        std::atomic<unsigned long long> written; // total events ever recorded
+        const char *name; // under registryMutex
+        int tid;
+    };
+
+    std::mutex registryMutex; // taken once per thread and while writing a trace
+    std::vector<ThreadBuffer *> registry;
+
+    ThreadBuffer *registerThread()
+    {
+        ThreadBuffer *buffer = new ThreadBuffer();
+        buffer->written.store(0, std::memory_order_relaxed);
+        for (Slot &slot : buffer->events)
+            slot.index.store(NO_EVENT, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer->tid = (int)registry.size() + 1;
+        buffer->name = NULL;
+        registry.push_back(buffer); // kept until exit, so a trace can outlive the thread
+        return buffer;
+    }
+
+    ThreadBuffer *threadBuffer()
+    {
+        static thread_local ThreadBuffer *buffer = registerThread();
+        return buffer;
+    }
+
+    // false if event i is gone, or was overwritten while it was copied
+    bool readEvent(const ThreadBuffer *buffer, unsigned long long i, Profiler::Event &event)
+    {
+        const Slot &slot = buffer->events[i % Profiler::CAPACITY];
+        if (slot.index.load(std::memory_order_acquire) != i)
+            return false;
+        // a field from a newer event makes the NO_EVENT before it visible
+        event.name = slot.name.load(std::memory_order_acquire);
+        event.start = slot.start.load(std::memory_order_acquire);
+        event.duration = slot.duration.load(std::memory_order_acquire);
+        return slot.index.load(std::memory_order_relaxed) == i;
+    }
+
+    void writeJsonString(FILE *file, const char *str)
+    {
+        fputc('"', file);
+        for (; *str; ++str)
+        {
+            if (*str == '"' || *str == '\\')
+                fputc('\\', file);
+            fputc(*str, file);
+        }
+        fputc('"', file);
+    }
+}
+
+long long Profiler::now()
+{
+    return Timer::getNanoSec();
+}
+
+void Profiler::record(const char *name, long long start, long long end)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    unsigned long long index = buffer->written.load(std::memory_order_relaxed);
+
+    // a seqlock, see readEvent(); release stores are plain stores on x86
+    Slot &slot = buffer->events[index % CAPACITY];
+    slot.index.store(NO_EVENT, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_release);
+    slot.start.store(start, std::memory_order_release);
+    slot.duration.store(end - start, std::memory_order_release);
+    slot.index.store(index, std::memory_order_release);
+
+    // publish the event to writeChromeTrace()
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const char *name)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->name = name;
+}
+
+bool Profiler::writeChromeTrace(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        std::cout << "Failed to write trace: " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    long long origin = -1;
+    for (ThreadBuffer *buffer : registry)
+    {
+        unsigned long long written = buffer->written.load(std::memory_order_acquire);
+        unsigned long long first = written > CAPACITY ? written - CAPACITY : 0;
+        // events are recorded when a zone ends, so parents come after their children
+        for (unsigned long long i = first; i < written; ++i)
+        {
+            Event event;
+            if (readEvent(buffer, i, event) && (origin < 0 || event.start < origin))
+                origin = event.start;
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool comma = false;
+    size_t count = 0;
+    for (ThreadBuffer *buffer : registry)
+    {
+        if (buffer->name)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", comma ? ",\n" : "", buffer->tid);
+            writeJsonString(file, buffer->name);
+            fprintf(file, "}}");
+            comma = true;
+        }
+
+        // the oldest events may be overwritten meanwhile, readEvent() drops those
+        unsigned long long written = buffer->written.load(std::memory_order_acquire);
+        unsigned long long first = written > CAPACITY ? written - CAPACITY : 0;
+        for (unsigned long long i = first; i < written; ++i)
+        {
+            Event event;
+            if (!readEvent(buffer, i, event))
+                continue;
+            fprintf(file, "%s{\"name\":", comma ? ",\n" : "");
+            writeJsonString(file, event.name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    buffer->tid, (event.start - origin) * 0.001, event.duration * 0.001);
+            comma = true;
+            count++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    std::cout << "Wrote " << count << " profiler events to " << path << std::endl;
+    return true;
+}
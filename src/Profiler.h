@@ -0,0 +1,61 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped CPU profiling zones, written to Chrome trace_event JSON (chrome://tracing, Perfetto).
+// Zones are compiled out in release (NDEBUG) builds unless SOLAR_PROFILE is defined.
+//
+//   void Planet::update(float deltaTime)
+//   {
+//       PROFILE_SCOPE("Planet::update");
+//       ...
+//   }
+//
+// Every thread records into its own fixed-size ring of events, so recording takes
+// no lock and never allocates after the first zone of a thread.
+
+#if !defined(NDEBUG) || defined(SOLAR_PROFILE)
+#define SOLAR_PROFILER_ENABLED 1
+#endif
+
+#include <atomic>
+
+class Profiler
+{
+public:
+    static const unsigned int CAPACITY = 1 << 16; // events kept per thread
+
+    struct Event
+    {
+        const char *name; // static string, never copied
+        long long start;  // ns
+        long long duration;
+    };
+
+    static long long now(); // ns, same clock as the events
+    static void record(const char *name, long long start, long long end);
+    static void setThreadName(const char *name);
+
+    // write the events currently held by every thread; safe to call while recording
+    static bool writeChromeTrace(const char *path);
+};
+
+class ProfileZone
+{
+public:
+    ProfileZone(const char *name) : name(name), start(Profiler::now()) {}
+    ~ProfileZone() { Profiler::record(name, start, Profiler::now()); }
+
+private:
+    const char *name;
+    long long start;
+};
+
+#ifdef SOLAR_PROFILER_ENABLED
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#endif
@@ -0,0 +1,157 @@
+#include "SceneGenerator.h"
+#include "Frustum.h"
+#include "Timer.h"
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+static const char *TEXTURE_PATHS[] = {
+    "textures/mercurymap.jpg", "textures/venusmap.jpg", "textures/earthmap1k.jpg", "textures/moonmap1k.jpg",
+    "textures/marsmap1k.jpg", "textures/jupitermap.jpg", "textures/saturnmap.png", "textures/uranusmap.png",
+    "textures/neptunemap.jpg", "textures/plutomap.png"};
+static const int TEXTURE_PATH_COUNT = sizeof(TEXTURE_PATHS) / sizeof(TEXTURE_PATHS[0]);
+
+SceneGenerator::SceneGenerator(const SceneParams &params, TextureManager &textureManager)
+    : params(params), state(params.seed ? params.seed : 1), textureManager(textureManager)
+{
+}
+
+void SceneGenerator::build(std::vector<Planet *> &planets)
+{
+    loadTextures();
+
+    int created = 0;
+    while (created < params.bodyCount)
+    {
+        float radius = randomOrbit();
+        // Kepler: angular speed falls with r^1.5, Earth (r = 30) keeps its 30 deg/s
+        float orbitSpeed = 30.0f * powf(30.0f / radius, 1.5f);
+        Texture *texture = textures.empty() ? NULL : textures[created % textures.size()];
+
+        Planet *planet = new Planet(radius, orbitSpeed, 5.0f + 25.0f * randomFloat(), 0.3f + 2.0f * randomFloat(), texture);
+        planet->orbitAngle = 360.0f * randomFloat();
+        planets.push_back(planet);
+        created++;
+
+        int moonCount = params.maxMoons > 0 ? (int)(randomFloat() * (params.maxMoons + 1)) : 0;
+        for (int i = 0; i < moonCount && created < params.bodyCount; ++i)
+        {
+            float moonRadius = planet->scale + 0.5f + 2.5f * randomFloat();
+            texture = textures.empty() ? NULL : textures[created % textures.size()];
+
+            Planet *moon = new Planet(moonRadius, 40.0f + 80.0f * randomFloat(), 15.0f, planet->scale * (0.1f + 0.2f * randomFloat()), texture);
+            moon->orbitAngle = 360.0f * randomFloat();
+            planet->addMoon(moon);
+            created++;
+        }
+    }
+
+    std::cout << "Generated scene with " << created << " bodies (" << planets.size() << " planets)" << std::endl;
+}
+
+void SceneGenerator::sweep(int maxBodies, TextureManager &textureManager, Shader &shader, ModernSphere &sphere, const glm::mat4 &view,
+                           const glm::mat4 &projection, const char *csvPath)
+{
+    const int FRAMES = 10;
+    FILE *csv = csvPath ? fopen(csvPath, "w") : NULL;
+    if (csv)
+        fprintf(csv, "bodies,update_ns_per_body,cull_ns_per_body,render_ns_per_body,visible\n");
+
+    printf("%10s %14s %14s %14s %10s\n", "bodies", "update ns", "cull ns", "render ns", "visible");
+
+    Frustum frustum(projection * view);
+    for (int count = 10; count <= maxBodies; count *= 10)
+    {
+        SceneParams params;
+        params.bodyCount = count;
+        SceneGenerator generator(params, textureManager);
+        std::vector<Planet *> planets;
+        generator.build(planets);
+        textureManager.loadAll();
+        textureManager.finish();
+
+        Timer timer;
+        double updateUs = 0.0, cullUs = 0.0, renderUs = 0.0;
+        std::vector<Planet *> visible;
+        visible.reserve(count);
+
+        shader.use();
+        sphere.setUniforms(shader);
+        for (int frame = 0; frame < FRAMES; ++frame)
+        {
+            timer.start();
+            for (Planet *planet : planets)
+                planet->update(1.0f / 60.0f);
+            updateUs += timer.getElapsedTimeInMicroSec();
+
+            timer.start();
+            visible.clear();
+            for (Planet *planet : planets)
+            {
+                if (planet->isVisible(frustum))
+                    visible.push_back(planet);
+                for (Planet *moon : planet->moons)
+                {
+                    if (moon->isVisible(frustum))
+                        visible.push_back(moon);
+                }
+            }
+            cullUs += timer.getElapsedTimeInMicroSec();
+
+            // what the cull pass kept, without testing it again. includes the GPU,
+            // glFinish waits for the frame to complete
+            timer.start();
+            for (Planet *body : visible)
+                body->draw(shader, sphere, view, projection);
+            glFinish();
+            renderUs += timer.getElapsedTimeInMicroSec();
+        }
+
+        double scale = 1000.0 / ((double)FRAMES * count);
+        printf("%10d %14.1f %14.1f %14.1f %10zu\n", count, updateUs * scale, cullUs * scale, renderUs * scale, visible.size());
+        fflush(stdout);
+        if (csv)
+            fprintf(csv, "%d,%.3f,%.3f,%.3f,%zu\n", count, updateUs * scale, cullUs * scale, renderUs * scale, visible.size());
+
+        for (Planet *planet : planets)
+            delete planet;
+    }
+
+    if (csv)
+        fclose(csv);
+}
+
+float SceneGenerator::randomFloat()
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+float SceneGenerator::randomOrbit()
+{
+    float u = randomFloat();
+    switch (params.distribution)
+    {
+    case ORBIT_LOG:
+        return params.minOrbit * powf(params.maxOrbit / params.minOrbit, u);
+    case ORBIT_BELT:
+    {
+        // Box-Muller, clamped to the range
+        float v = randomFloat();
+        float g = sqrtf(-2.0f * logf(1.0f - u)) * cosf(6.2831853f * v);
+        float r = 0.5f * (params.minOrbit + params.maxOrbit) + g * 0.1f * (params.maxOrbit - params.minOrbit);
+        return r < params.minOrbit ? params.minOrbit : (r > params.maxOrbit ? params.maxOrbit : r);
+    }
+    default:
+        return params.minOrbit + (params.maxOrbit - params.minOrbit) * u;
+    }
+}
+
+void SceneGenerator::loadTextures()
+{
+    int count = params.textureCount < TEXTURE_PATH_COUNT ? params.textureCount : TEXTURE_PATH_COUNT;
+    for (int i = (int)textures.size(); i < count; ++i)
+        textures.push_back(textureManager.load(TEXTURE_PATHS[i]));
+}
@@ -0,0 +1,55 @@
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+#include <glm/glm.hpp>
+#include <vector>
+#include "Planet.h"
+#include "Shader.h"
+#include "ModernSphere.h"
+#include "TextureManager.h"
+
+enum OrbitDistribution
+{
+    ORBIT_UNIFORM,   // orbit radius uniform between min and max
+    ORBIT_LOG,       // more bodies close to the sun, like the real system
+    ORBIT_BELT       // gaussian belt around the middle of the range
+};
+
+struct SceneParams
+{
+    int bodyCount;  // planets and moons
+    OrbitDistribution distribution;
+    float minOrbit;
+    float maxOrbit;
+    int maxMoons;     // each planet gets 0..maxMoons moons
+    int textureCount; // distinct textures, shared between bodies
+    unsigned int seed;
+
+    SceneParams() : bodyCount(1000), distribution(ORBIT_LOG), minOrbit(15.0f), maxOrbit(400.0f),
+                    maxMoons(3), textureCount(10), seed(1) {}
+};
+
+// Procedural scenes of any size, built with the same Planet/addMoon calls as
+// the hand-made solar system in main().
+class SceneGenerator
+{
+public:
+    SceneGenerator(const SceneParams &params, TextureManager &textureManager);
+
+    void build(std::vector<Planet *> &planets);
+
+    // build scenes of 10, 100, ... maxBodies bodies and print the update, cull and render cost per body
+    static void sweep(int maxBodies, TextureManager &textureManager, Shader &shader, ModernSphere &sphere, const glm::mat4 &view,
+                      const glm::mat4 &projection, const char *csvPath);
+
+private:
+    float randomFloat(); // [0, 1)
+    float randomOrbit();
+    void loadTextures();
+
+    SceneParams params;
+    unsigned int state; // xorshift32
+    TextureManager &textureManager;
+    std::vector<Texture *> textures;
+};
+
+#endif
@@ -1,48 +1,91 @@
 #include "Shader.h"
+#include "Profiler.h"
+#include "MemoryStats.h"
+#include "Probes.h"
+#include "AssetPack.h"
+#include <cstring>
+
+// the source with defines after its #version line, which has to stay first
+static void setSource(unsigned int shader, const char *code, GLint length, const char *defines)
+{
+    GLint versionLength = 0;
+    if (length >= 8 && strncmp(code, "#version", 8) == 0)
+    {
+        const char *end = (const char *)memchr(code, '\n', length);
+        versionLength = end ? (GLint)(end - code) + 1 : length;
+    }
+    const char *sources[3] = {code, defines, code + versionLength};
+    GLint lengths[3] = {versionLength, (GLint)strlen(defines), length - versionLength};
+    glShaderSource(shader, 3, sources, lengths);
+}
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath)
+Shader::Shader(const char *vertexPath, const char *fragmentPath, const char *defines)
 {
+    PROFILE_SCOPE("Shader::Shader");
+
     std::string vertexCode;
     std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
+    const char *vShaderCode;
+    const char *fShaderCode;
+    GLint vertexLength, fragmentLength;
 
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    try
+    // compiled straight from the asset pack's mapping when it has both
+    Asset vertexAsset, fragmentAsset;
+    if (AssetPack::find(vertexPath, vertexAsset) && AssetPack::find(fragmentPath, fragmentAsset))
     {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-
-        vShaderFile.close();
-        fShaderFile.close();
-
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        vShaderCode = (const char *)vertexAsset.data;
+        fShaderCode = (const char *)fragmentAsset.data;
+        vertexLength = (GLint)vertexAsset.size;
+        fragmentLength = (GLint)fragmentAsset.size;
     }
-    catch (std::ifstream::failure e)
+    else
     {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+        std::ifstream vShaderFile;
+        std::ifstream fShaderFile;
+
+        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+        try
+        {
+            vShaderFile.open(vertexPath);
+            fShaderFile.open(fragmentPath);
+            std::stringstream vShaderStream, fShaderStream;
+
+            vShaderStream << vShaderFile.rdbuf();
+            fShaderStream << fShaderFile.rdbuf();
+
+            vShaderFile.close();
+            fShaderFile.close();
+
+            vertexCode = vShaderStream.str();
+            fragmentCode = fShaderStream.str();
+        }
+        catch (std::ifstream::failure e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+        }
+
+        vShaderCode = vertexCode.c_str();
+        fShaderCode = fragmentCode.c_str();
+        vertexLength = (GLint)vertexCode.size();
+        fragmentLength = (GLint)fragmentCode.size();
     }
 
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
+    long long sourceBytes = vertexCode.size() + fragmentCode.size();
+    MemoryStats::addCpu(MEM_SHADER, sourceBytes);
 
     unsigned int vertex, fragment;
+    long long compileStart = Profiler::now();
 
     // Vertex Shader
     vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
+    setSource(vertex, vShaderCode, vertexLength, defines);
     glCompileShader(vertex);
 
     // Fragment Shader
     fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
+    setSource(fragment, fShaderCode, fragmentLength, defines);
     glCompileShader(fragment);
 
     // Shader Program
@@ -54,6 +97,9 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
     // Delete shader
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+    PROBE4(shader_compile, vertexPath, fragmentPath, ID, Profiler::now() - compileStart);
+
+    MemoryStats::addCpu(MEM_SHADER, -sourceBytes);
 }
 
 void Shader::use()
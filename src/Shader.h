@@ -12,7 +12,8 @@ class Shader
 public:
     unsigned int ID;
 
-    Shader(const char *vertexPath, const char *fragmentPath);
+    // defines (e.g. "#define LOG_DEPTH\n") are inserted after the #version line of both stages
+    Shader(const char *vertexPath, const char *fragmentPath, const char *defines = "");
 
     void use();
 
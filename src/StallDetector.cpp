@@ -0,0 +1,298 @@
+#include "StallDetector.h"
+
+#ifdef SOLAR_STALL_DETECT
+#include "Profiler.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <iostream>
+
+// KHR_debug, not part of the 3.3 core glad loader
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+#ifndef GL_DEBUG_OUTPUT_SYNCHRONOUS
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#endif
+#ifndef GL_DEBUG_TYPE_PERFORMANCE
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#endif
+#ifndef GL_DONT_CARE
+#define GL_DONT_CARE 0x1100
+#endif
+typedef void (APIENTRY *PFNDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROC callback, const void *userParam);
+typedef void (APIENTRY *PFNDEBUGMESSAGECONTROLPROC)(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint *ids,
+                                                   GLboolean enabled);
+
+static const int SITE_DEPTH = 3; // return addresses kept per site
+static const int MAX_SITES = 256;
+
+struct Site
+{
+    const char *call;
+    void *frames[SITE_DEPTH];
+    unsigned long long count;
+    unsigned long long driverMessages;
+    long long totalNs;
+    long long maxNs;
+};
+
+// GL is only called from the main thread
+static Site sites[MAX_SITES];
+static int siteCount = 0;
+static unsigned long long droppedSites = 0;
+static unsigned long long frameCount = 0;
+
+// the call in progress, for the synchronous KHR_debug callback
+static const char *currentCall = NULL;
+static void **currentFrames = NULL;
+
+__attribute__((noinline)) static void getFrames(void **frames)
+{
+    // skip getFrames and the wrapper
+    void *stack[SITE_DEPTH + 2];
+    int depth = backtrace(stack, SITE_DEPTH + 2);
+    for (int i = 0; i < SITE_DEPTH; ++i)
+        frames[i] = i + 2 < depth ? stack[i + 2] : NULL;
+}
+
+static Site *findSite(const char *call, void *const *frames)
+{
+    for (int i = 0; i < siteCount; ++i)
+    {
+        if (sites[i].call == call && memcmp(sites[i].frames, frames, sizeof(sites[i].frames)) == 0)
+            return &sites[i];
+    }
+    if (siteCount == MAX_SITES)
+    {
+        droppedSites++;
+        return NULL;
+    }
+
+    Site &site = sites[siteCount++];
+    site.call = call;
+    memcpy(site.frames, frames, sizeof(site.frames));
+    return &site;
+}
+
+// "Shader::setMat4 (solar-system+0x1a2b)"
+static void describe(void *address, char *text, size_t size)
+{
+    Dl_info info;
+    if (!address || !dladdr(address, &info))
+    {
+        snprintf(text, size, "%p", address);
+        return;
+    }
+
+    const char *module = info.dli_fname ? strrchr(info.dli_fname, '/') : NULL;
+    module = module ? module + 1 : (info.dli_fname ? info.dli_fname : "?");
+    unsigned long offset = (unsigned long)((char *)address - (char *)info.dli_fbase);
+    if (!info.dli_sname)
+    {
+        snprintf(text, size, "%s+0x%lx", module, offset);
+        return;
+    }
+
+    int status;
+    char *name = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+    snprintf(text, size, "%s (%s+0x%lx)", status == 0 ? name : info.dli_sname, module, offset);
+    free(name);
+}
+
+static void printSite(void *const *frames)
+{
+    char text[256];
+    for (int i = 0; i < SITE_DEPTH && frames[i]; ++i)
+    {
+        describe(frames[i], text, sizeof(text));
+        std::cout << (i == 0 ? "    at " : "    from ") << text << std::endl;
+    }
+}
+
+static void record(const char *call, void *const *frames, long long ns, bool always)
+{
+    if (!always && ns < StallDetector::SLOW_MS * 1e6)
+        return;
+
+    Site *site = findSite(call, frames);
+    if (site)
+    {
+        site->count++;
+        site->totalNs += ns;
+        site->maxNs = std::max(site->maxNs, ns);
+    }
+
+    if (ns >= StallDetector::REPORT_MS * 1e6)
+    {
+        std::cout << "GL stall: " << call << " blocked " << ns / 1e6 << " ms" << std::endl;
+        printSite(frames);
+    }
+}
+
+static void APIENTRY debugMessage(GLenum, GLenum type, GLuint, GLenum, GLsizei, const GLchar *message, const void *)
+{
+    if (type != GL_DEBUG_TYPE_PERFORMANCE)
+        return;
+
+    std::cout << "GL performance: " << message << std::endl;
+    if (!currentCall)
+        return;
+
+    // runs inside the offending call, which is being timed by its wrapper
+    std::cout << "  during " << currentCall << std::endl;
+    printSite(currentFrames);
+    Site *site = findSite(currentCall, currentFrames);
+    if (site)
+        site->driverMessages++;
+}
+
+// timing wrappers, each forwards to the pointer glad loaded. ALWAYS calls are
+// recorded every time, the others only when they took longer than SLOW_MS
+#define ALWAYS true
+#define IF_SLOW false
+#define TIMED(kind, ret, name, params, args) \
+    static decltype(glad_##name) real_##name; \
+    static ret APIENTRY timed_##name params \
+    { \
+        void *frames[SITE_DEPTH]; \
+        getFrames(frames); \
+        currentCall = #name; \
+        currentFrames = frames; \
+        struct Done \
+        { \
+            void **frames; \
+            long long start; \
+            ~Done() \
+            { \
+                record(#name, frames, Profiler::now() - start, kind); \
+                currentCall = NULL; \
+            } \
+        } done = {frames, Profiler::now()}; \
+        return real_##name args; \
+    }
+
+TIMED(ALWAYS, void, glFinish, (), ())
+TIMED(ALWAYS, void, glReadPixels, (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels),
+      (x, y, width, height, format, type, pixels))
+TIMED(ALWAYS, void, glGetTexImage, (GLenum target, GLint level, GLenum format, GLenum type, void *pixels),
+      (target, level, format, type, pixels))
+TIMED(ALWAYS, void, glGetBufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, void *data), (target, offset, size, data))
+
+TIMED(ALWAYS, void, glGetIntegerv, (GLenum pname, GLint *data), (pname, data))
+TIMED(ALWAYS, void, glGetInteger64v, (GLenum pname, GLint64 *data), (pname, data))
+TIMED(ALWAYS, void, glGetFloatv, (GLenum pname, GLfloat *data), (pname, data))
+TIMED(ALWAYS, void, glGetDoublev, (GLenum pname, GLdouble *data), (pname, data))
+TIMED(ALWAYS, void, glGetBooleanv, (GLenum pname, GLboolean *data), (pname, data))
+TIMED(ALWAYS, GLint, glGetUniformLocation, (GLuint program, const GLchar *name), (program, name))
+TIMED(ALWAYS, GLint, glGetAttribLocation, (GLuint program, const GLchar *name), (program, name))
+
+TIMED(IF_SLOW, GLenum, glGetError, (), ())
+TIMED(IF_SLOW, void, glGetQueryObjectiv, (GLuint id, GLenum pname, GLint *params), (id, pname, params))
+TIMED(IF_SLOW, void, glGetQueryObjectuiv, (GLuint id, GLenum pname, GLuint *params), (id, pname, params))
+TIMED(IF_SLOW, void, glGetQueryObjecti64v, (GLuint id, GLenum pname, GLint64 *params), (id, pname, params))
+TIMED(IF_SLOW, void, glGetQueryObjectui64v, (GLuint id, GLenum pname, GLuint64 *params), (id, pname, params))
+TIMED(IF_SLOW, GLenum, glClientWaitSync, (GLsync sync, GLbitfield flags, GLuint64 timeout), (sync, flags, timeout))
+TIMED(IF_SLOW, void, glBufferData, (GLenum target, GLsizeiptr size, const void *data, GLenum usage), (target, size, data, usage))
+TIMED(IF_SLOW, void, glBufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void *data), (target, offset, size, data))
+TIMED(IF_SLOW, void *, glMapBuffer, (GLenum target, GLenum access), (target, access))
+TIMED(IF_SLOW, void *, glMapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access),
+      (target, offset, length, access))
+TIMED(IF_SLOW, void, glTexSubImage2D,
+      (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels),
+      (target, level, xoffset, yoffset, width, height, format, type, pixels))
+
+#define INSTALL(name) \
+    if (glad_##name) \
+    { \
+        real_##name = glad_##name; \
+        glad_##name = timed_##name; \
+    }
+
+void StallDetector::setWindowHints()
+{
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+}
+
+void StallDetector::install()
+{
+    INSTALL(glFinish)
+    INSTALL(glReadPixels)
+    INSTALL(glGetTexImage)
+    INSTALL(glGetBufferSubData)
+    INSTALL(glGetIntegerv)
+    INSTALL(glGetInteger64v)
+    INSTALL(glGetFloatv)
+    INSTALL(glGetDoublev)
+    INSTALL(glGetBooleanv)
+    INSTALL(glGetUniformLocation)
+    INSTALL(glGetAttribLocation)
+    INSTALL(glGetError)
+    INSTALL(glGetQueryObjectiv)
+    INSTALL(glGetQueryObjectuiv)
+    INSTALL(glGetQueryObjecti64v)
+    INSTALL(glGetQueryObjectui64v)
+    INSTALL(glClientWaitSync)
+    INSTALL(glBufferData)
+    INSTALL(glBufferSubData)
+    INSTALL(glMapBuffer)
+    INSTALL(glMapBufferRange)
+    INSTALL(glTexSubImage2D)
+
+    // KHR_debug is core in GL 4.3, without a suffix
+    PFNDEBUGMESSAGECALLBACKPROC debugMessageCallback = NULL;
+    PFNDEBUGMESSAGECONTROLPROC debugMessageControl = NULL;
+    if (glfwExtensionSupported("GL_KHR_debug"))
+    {
+        debugMessageCallback = (PFNDEBUGMESSAGECALLBACKPROC)glfwGetProcAddress("glDebugMessageCallback");
+        debugMessageControl = (PFNDEBUGMESSAGECONTROLPROC)glfwGetProcAddress("glDebugMessageControl");
+    }
+    if (debugMessageCallback && debugMessageControl)
+    {
+        // synchronous, so the message arrives inside the call that caused it
+        glEnable(GL_DEBUG_OUTPUT);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_FALSE);
+        debugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+        debugMessageCallback(debugMessage, NULL);
+        std::cout << "Stall detector installed, with KHR_debug performance messages" << std::endl;
+    }
+    else
+    {
+        std::cout << "Stall detector installed, no KHR_debug: timing only" << std::endl;
+    }
+}
+
+void StallDetector::endFrame()
+{
+    frameCount++;
+}
+
+void StallDetector::printReport()
+{
+    std::sort(sites, sites + siteCount, [](const Site &a, const Site &b) { return a.totalNs > b.totalNs; });
+
+    std::cout << "GL sync points over " << frameCount << " frames, by total time:" << std::endl;
+    for (int i = 0; i < siteCount; ++i)
+    {
+        const Site &site = sites[i];
+        double perFrame = frameCount ? (double)site.count / frameCount : 0.0;
+        printf("  %-22s %10llu calls %9.2f/frame %10.3f ms total %8.3f ms max", site.call, site.count, perFrame, site.totalNs / 1e6,
+               site.maxNs / 1e6);
+        if (site.driverMessages)
+            printf(" %llu driver messages", site.driverMessages);
+        printf("\n");
+        fflush(stdout);
+        printSite(site.frames);
+    }
+    if (droppedSites)
+        std::cout << "  " << droppedSites << " calls from further sites not recorded" << std::endl;
+}
+
+#endif
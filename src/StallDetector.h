@@ -0,0 +1,31 @@
+#ifndef STALL_DETECTOR_H
+#define STALL_DETECTOR_H
+
+// Debug mode that finds GL calls which make the CPU wait for the GPU: state and
+// uniform location queries, readbacks, glFinish, and uploads or maps that block
+// on a buffer still in use. Like GlStats it swaps glad's function pointers, for
+// wrappers that time every call and remember its call site. KHR_debug performance
+// messages, where the driver has them, are printed with the call that caused them.
+//
+// Only built with SOLAR_STALL_DETECT; link with -rdynamic to get function names
+// in the report, otherwise sites are printed as module offsets for addr2line.
+class StallDetector
+{
+public:
+#ifdef SOLAR_STALL_DETECT
+    static constexpr double REPORT_MS = 1.0;  // printed as it happens
+    static constexpr double SLOW_MS = 0.05;   // uploads and maps faster than this are not stalls
+
+    static void setWindowHints(); // before glfwCreateWindow, asks for a debug context
+    static void install();        // after gladLoadGLLoader
+    static void endFrame();
+    static void printReport();
+#else
+    static void setWindowHints() {}
+    static void install() {}
+    static void endFrame() {}
+    static void printReport() {}
+#endif
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "Telemetry.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// reads of one slot before read() gives up on it
+static const int READ_TRIES = 100;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "telemetry atomics are shared between processes and must be lock free");
+
+Telemetry::Telemetry() : block(0)
+{
+    getName(getpid(), name, sizeof(name));
+
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        std::cout << "Telemetry disabled, shm_open failed: " << name << std::endl;
+        return;
+    }
+    if (ftruncate(fd, sizeof(TelemetryBlock)) != 0)
+    {
+        std::cout << "Telemetry disabled, ftruncate failed: " << name << std::endl;
+        close(fd);
+        shm_unlink(name);
+        return;
+    }
+    void *memory = mmap(0, sizeof(TelemetryBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        std::cout << "Telemetry disabled, mmap failed: " << name << std::endl;
+        shm_unlink(name);
+        return;
+    }
+
+    // the pages are zero filled, which is a valid state for every slot
+    block = (TelemetryBlock *)memory;
+    block->slotCount = TelemetryBlock::SLOTS;
+    block->frameSize = sizeof(TelemetryFrame);
+    block->pid = getpid();
+    block->version = TelemetryBlock::VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    block->magic = TelemetryBlock::MAGIC;
+}
+
+Telemetry::~Telemetry()
+{
+    if (!block)
+        return;
+    munmap(block, sizeof(TelemetryBlock));
+    shm_unlink(name);
+}
+
+void Telemetry::publish(const TelemetryFrame &frame)
+{
+    if (!block)
+        return;
+
+    uint64_t index = block->written.load(std::memory_order_relaxed);
+    TelemetrySlot &slot = block->slots[index % TelemetryBlock::SLOTS];
+
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.frame, &frame, sizeof(TelemetryFrame));
+    slot.frame.frame = index;
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+
+    block->written.store(index + 1, std::memory_order_release);
+}
+
+TelemetryBlock *Telemetry::attach(int pid)
+{
+    char name[64];
+    getName(pid, name, sizeof(name));
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return 0;
+    void *memory = mmap(0, sizeof(TelemetryBlock), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+        return 0;
+
+    TelemetryBlock *block = (TelemetryBlock *)memory;
+    if (block->magic != TelemetryBlock::MAGIC || block->version != TelemetryBlock::VERSION ||
+        block->frameSize != sizeof(TelemetryFrame) || block->slotCount != TelemetryBlock::SLOTS)
+    {
+        std::cout << "Telemetry layout of " << name << " does not match this build" << std::endl;
+        munmap(memory, sizeof(TelemetryBlock));
+        return 0;
+    }
+    return block;
+}
+
+void Telemetry::detach(TelemetryBlock *block)
+{
+    if (block)
+        munmap(block, sizeof(TelemetryBlock));
+}
+
+bool Telemetry::read(const TelemetryBlock *block, uint64_t index, TelemetryFrame &frame)
+{
+    const TelemetrySlot &slot = block->slots[index % TelemetryBlock::SLOTS];
+    for (int i = 0; i < READ_TRIES; ++i)
+    {
+        // the slot has been reused for a newer frame
+        if (block->written.load(std::memory_order_acquire) > index + TelemetryBlock::SLOTS)
+            return false;
+
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            // let the writer finish, it may be on this core
+            sched_yield();
+            continue;
+        }
+        memcpy(&frame, &slot.frame, sizeof(TelemetryFrame));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = slot.sequence.load(std::memory_order_relaxed);
+        if (before == after)
+            return frame.frame == index;
+    }
+    // the writer stopped mid-write, e.g. the app died
+    return false;
+}
+
+void Telemetry::getName(int pid, char *name, int size)
+{
+    snprintf(name, size, "/solar-system-%d", pid);
+}
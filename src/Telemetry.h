@@ -0,0 +1,75 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <atomic>
+#include <cstdint>
+
+// One frame as seen by an external dashboard (tools/telemetry_dump).
+// Plain data only, the layout is shared between processes.
+struct TelemetryFrame
+{
+    static const int MAX_PASSES = 8;
+    static const int NAME_SIZE = 16;
+
+    uint64_t frame; // set by Telemetry::publish
+    double time; // s since start
+    float frameMs;
+    float cpuMs;
+    float gpuMs; // a few frames late
+    float presentMs;
+    uint32_t bodies;
+    uint32_t drawCalls;
+    uint32_t triangles;
+    uint32_t passCount;
+    int64_t cpuBytes; // tagged, all tags
+    int64_t gpuBytes;
+    uint64_t allocations; // operator new calls since start
+    char passNames[MAX_PASSES][NAME_SIZE];
+    float passMs[MAX_PASSES];
+};
+
+struct TelemetrySlot
+{
+    std::atomic<uint32_t> sequence; // odd while the slot is being written
+    TelemetryFrame frame;
+};
+
+struct TelemetryBlock
+{
+    static const uint32_t MAGIC = 0x534f4c54; // "SOLT"
+    static const uint32_t VERSION = 1;
+    static const int SLOTS = 256;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t frameSize;
+    int32_t pid;
+    std::atomic<uint64_t> written; // frames published so far
+    TelemetrySlot slots[SLOTS];
+};
+
+// Publishes one TelemetryFrame per frame into a POSIX shared memory ring named
+// /solar-system-<pid>. Each slot is a seqlock: the writer never waits and never
+// makes a system call, readers retry when they raced with it, a few times: a
+// writer that died mid-write leaves its slot odd for good.
+class Telemetry
+{
+public:
+    Telemetry();
+    ~Telemetry(); // unlinks the shared memory
+
+    bool isOpen() const { return block != 0; }
+    void publish(const TelemetryFrame &frame);
+
+    // reader side
+    static TelemetryBlock *attach(int pid); // NULL if there is no such app
+    static void detach(TelemetryBlock *block);
+    static bool read(const TelemetryBlock *block, uint64_t index, TelemetryFrame &frame); // false if overwritten or still being written
+    static void getName(int pid, char *name, int size);
+
+private:
+    TelemetryBlock *block;
+    char name[64];
+};
+
+#endif
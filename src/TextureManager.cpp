@@ -0,0 +1,820 @@
+#include "TextureManager.h"
+#include "Profiler.h"
+#include "MemoryStats.h"
+#include "Probes.h"
+#include "AssetPack.h"
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// EXT_texture_compression_s3tc, not part of the 3.3 core glad loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// GL 4.2 / ARB_texture_storage, not part of the 3.3 core glad loader
+typedef void (*PFNTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+static PFNTEXSTORAGE2DPROC texStorage2D = NULL;
+
+// GL internal format of a baked file, 0 if the driver can't take it
+static GLenum getBakedFormat(unsigned int format, bool compressedSupported)
+{
+    switch (format)
+    {
+    case KTX2_BC1_RGB_UNORM:
+        return compressedSupported ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+    case KTX2_BC3_UNORM:
+        return compressedSupported ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+    case KTX2_R8G8B8A8_UNORM:
+        return GL_RGBA8;
+    }
+    return 0;
+}
+
+// textures/earthmap1k.jpg -> textures/earthmap1k.ktx2
+static std::string getBakedPath(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    return path.substr(0, dot) + ".ktx2";
+}
+
+// a streamed level blends in over this many frames
+static const int FADE_FRAMES = 15;
+
+// levels in a full mip chain down to 1x1
+static int getLevelCount(int width, int height)
+{
+    int levels = 1;
+    while ((width | height) >> levels)
+        levels++;
+    return levels;
+}
+
+// defines one level of the bound texture, from the bound unpack buffer if data is an offset;
+// with immutable storage the level already exists and is only filled
+static void defineLevel(unsigned int ktx2Format, GLenum format, int level, int width, int height, size_t size, const void *data,
+                        bool immutable = false)
+{
+    if (Ktx2::isCompressed(ktx2Format))
+    {
+        if (immutable)
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, (GLsizei)size, data);
+        else
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, (GLsizei)size, data);
+    }
+    else
+    {
+        if (immutable)
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+}
+
+TextureManager::TextureManager(int threads)
+    : stagingBytes(0), pending(0), streaming(0), viewportHeight(0), residencyBudget(RESIDENCY_BUDGET), residentBytes(0), loadingBytes(0), frame(0),
+      reportedFull(false), stopping(false)
+{
+    compressedSupported = glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+    if (!texStorage2D && glfwExtensionSupported("GL_ARB_texture_storage"))
+        texStorage2D = (PFNTEXSTORAGE2DPROC)glfwGetProcAddress("glTexStorage2D");
+
+    // mid grey, so an unloaded body is still shaded
+    static const unsigned char grey[4] = {128, 128, 128, 255};
+    glGenTextures(1, &placeholder);
+    glBindTexture(GL_TEXTURE_2D, placeholder);
+    if (texStorage2D)
+    {
+        texStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    if (threads <= 0)
+    {
+        threads = (int)std::thread::hardware_concurrency() - 1;
+        if (threads < 1)
+            threads = 1;
+    }
+    for (int i = 0; i < threads; ++i)
+        workers.push_back(std::thread(&TextureManager::work, this));
+}
+
+TextureManager::~TextureManager()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+
+    for (Texture *texture : textures)
+    {
+        release(*texture);
+        if (texture->id != placeholder)
+        {
+            MemoryStats::untrackGpu(MEM_TEXTURE, texture->id);
+            glDeleteTextures(1, &texture->id);
+        }
+        delete texture->ktx2;
+        delete texture;
+    }
+    glDeleteTextures(1, &placeholder);
+}
+
+Texture *TextureManager::load(const char *path)
+{
+    auto it = byPath.find(path);
+    if (it != byPath.end())
+        return it->second;
+
+    Texture *texture = new Texture();
+    texture->path = path;
+    texture->id = placeholder;
+    texture->state = TEXTURE_UNLOADED;
+    texture->width = texture->height = texture->channels = 0;
+    texture->ktx2 = NULL;
+    texture->packed = NULL;
+    texture->baked = false;
+    texture->staging = 0;
+    texture->stagingData = NULL;
+    texture->stagingSize = 0;
+    texture->residentLevel = texture->coarseLevel = texture->finestLevel = texture->wantedLevel = 0;
+    texture->loadingLevel = -1;
+    texture->unusedFrames = 0;
+    texture->requested = texture->priority = texture->fade = 0.0f;
+    texture->residentBytes = 0;
+    texture->lastUsed = 0;
+    textures.push_back(texture);
+    byPath[texture->path] = texture;
+    return texture;
+}
+
+void TextureManager::loadAll()
+{
+    for (Texture *texture : textures)
+    {
+        if (texture->state == TEXTURE_UNLOADED || texture->state == TEXTURE_EVICTED)
+            enqueue(*texture);
+    }
+}
+
+void TextureManager::unloadAll()
+{
+    for (Texture *texture : textures)
+        unload(*texture);
+}
+
+void TextureManager::enqueue(Texture &texture)
+{
+    texture.state = TEXTURE_LOADING;
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({&texture, -1, false});
+    }
+    wake.notify_one();
+}
+
+void TextureManager::work()
+{
+    Profiler::setThreadName("texture decode");
+    // fill() flips the rows itself
+    stbi_set_flip_vertically_on_load_thread(false);
+
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            job = queue.front();
+            queue.pop_front();
+        }
+
+        Texture *texture = job.texture;
+        if (job.level >= 0)
+        {
+            PROFILE_SCOPE("TextureManager::readLevel");
+            job.ok = readLevel(*texture, job.level, texture->stagingData);
+        }
+        else if (!texture->stagingData)
+        {
+            job.ok = readHeader(*texture);
+        }
+        else
+        {
+            job.ok = fill(*texture);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.push_back(job);
+        }
+        decoded.notify_all();
+    }
+}
+
+bool TextureManager::readHeader(Texture &texture)
+{
+    PROFILE_SCOPE("TextureManager::readHeader");
+
+    std::string bakedPath = getBakedPath(texture.path);
+    Ktx2Image *ktx2 = new Ktx2Image();
+    Asset asset;
+    bool packed = AssetPack::find(bakedPath, asset);
+    bool found = packed ? Ktx2::readMemory(bakedPath.c_str(), asset.data, asset.size, *ktx2) : Ktx2::readHeader(bakedPath.c_str(), *ktx2);
+    if (found && getBakedFormat(ktx2->format, compressedSupported))
+    {
+        // only the coarse levels now, the rest is streamed on demand
+        int last = (int)ktx2->levels.size() - 1;
+        int coarse = 0;
+        while (coarse < last && (ktx2->levels[coarse].width > COARSE_SIZE || ktx2->levels[coarse].height > COARSE_SIZE))
+            coarse++;
+
+        texture.ktx2 = ktx2;
+        texture.packed = packed ? asset.data : NULL;
+        texture.baked = true;
+        texture.width = ktx2->width;
+        texture.height = ktx2->height;
+        texture.coarseLevel = texture.residentLevel = texture.wantedLevel = coarse;
+        texture.stagingSize = 0;
+        for (int i = coarse; i <= last; ++i)
+            texture.stagingSize += ktx2->levels[i].size;
+        return true;
+    }
+    delete ktx2;
+
+    // the image is decoded once there is a buffer for it
+    if (AssetPack::find(texture.path, asset))
+        found = stbi_info_from_memory(asset.data, (int)asset.size, &texture.width, &texture.height, &texture.channels);
+    else
+        found = stbi_info(texture.path.c_str(), &texture.width, &texture.height, &texture.channels);
+    texture.stagingSize = (long long)texture.width * texture.height * texture.channels;
+    return found && texture.stagingSize > 0;
+}
+
+bool TextureManager::fill(Texture &texture)
+{
+    if (texture.ktx2)
+    {
+        PROFILE_SCOPE("TextureManager::readLevels");
+        // the coarse levels, back to back
+        size_t offset = 0;
+        for (size_t i = texture.coarseLevel; i < texture.ktx2->levels.size(); ++i)
+        {
+            if (!readLevel(texture, (int)i, texture.stagingData + offset))
+                return false;
+            offset += texture.ktx2->levels[i].size;
+        }
+        return true;
+    }
+
+    PROFILE_SCOPE("TextureManager::decode");
+    int width, height, channels;
+    Asset asset;
+    unsigned char *pixels;
+    if (AssetPack::find(texture.path, asset))
+        pixels = stbi_load_from_memory(asset.data, (int)asset.size, &width, &height, &channels, 0);
+    else
+        pixels = stbi_load(texture.path.c_str(), &width, &height, &channels, 0);
+    if (!pixels)
+        return false;
+
+    long long bytes = (long long)width * height * channels;
+    MemoryStats::addCpu(MEM_TRANSIENT, bytes);
+    // the file may have changed since its header was read
+    bool ok = width == texture.width && height == texture.height && channels == texture.channels;
+    if (ok)
+    {
+        // stbi has no scanline API to decode into the mapped buffer: copied from its
+        // buffer, and flipped on the way since GL wants the bottom row first
+        size_t row = (size_t)width * channels;
+        for (int y = 0; y < height; ++y)
+            memcpy(texture.stagingData + (height - 1 - y) * row, pixels + y * row, row);
+    }
+    MemoryStats::addCpu(MEM_TRANSIENT, -bytes);
+    stbi_image_free(pixels);
+    return ok;
+}
+
+// a baked level, from the asset pack or the file
+bool TextureManager::readLevel(const Texture &texture, int level, unsigned char *data) const
+{
+    const Ktx2Level &info = texture.ktx2->levels[level];
+    if (texture.packed)
+    {
+        memcpy(data, texture.packed + info.offset, info.size);
+        return true;
+    }
+    return Ktx2::readLevel(getBakedPath(texture.path).c_str(), info, data);
+}
+
+void TextureManager::update()
+{
+    PROFILE_SCOPE("TextureManager::update");
+
+    frame++;
+    std::vector<Job> ready;
+    if (pending > 0 || streaming > 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(done);
+    }
+
+    long long uploaded = 0;
+    for (size_t i = 0; i < ready.size(); ++i)
+    {
+        // over budget: the rest waits for the next frame
+        if (uploaded >= UPLOAD_BUDGET)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.insert(done.begin(), ready.begin() + i, ready.end());
+            break;
+        }
+
+        Texture &texture = *ready[i].texture;
+        int level = ready[i].level;
+        if (level >= 0)
+        {
+            texture.loadingLevel = -1;
+            loadingBytes -= texture.ktx2->levels[level].size;
+            streaming--;
+            if (!ready[i].ok)
+            {
+                std::cout << "Failed to stream texture: " << texture.path << " level " << level << std::endl;
+                texture.finestLevel = level + 1;
+                release(texture);
+            }
+            else
+            {
+                uploaded += texture.ktx2->levels[level].size;
+                uploadLevel(texture, level);
+            }
+            continue;
+        }
+
+        if (!ready[i].ok)
+        {
+            std::cout << "Failed to load texture: " << texture.path << std::endl;
+            release(texture);
+            texture.state = TEXTURE_FAILED;
+        }
+        else if (!texture.stagingData)
+        {
+            // only the header so far
+            unstaged.push_back(&texture);
+            continue;
+        }
+        else
+        {
+            uploaded += texture.stagingSize;
+            if (texture.ktx2)
+                uploadBaked(texture);
+            else
+                upload(texture);
+        }
+        pending--;
+    }
+
+    stage();
+    stream();
+}
+
+void TextureManager::finish()
+{
+    // something is always mapped or being read while textures are pending, so done fills up again
+    while (pending > 0)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decoded.wait(lock, [this]() { return !done.empty(); });
+        }
+        update();
+    }
+}
+
+bool TextureManager::map(Texture &texture, long long size)
+{
+    glGenBuffers(1, &texture.staging);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.staging);
+    // a new buffer each time, so this never waits for an upload still reading the last one
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    texture.stagingData = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    texture.stagingSize = size;
+    stagingBytes += size;
+    MemoryStats::trackGpu(MEM_TRANSIENT, texture.staging, size);
+
+    if (!texture.stagingData)
+    {
+        std::cout << "Failed to map an unpack buffer for texture: " << texture.path << std::endl;
+        release(texture);
+        return false;
+    }
+    return true;
+}
+
+void TextureManager::bindStaging(Texture &texture)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.staging);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    texture.stagingData = NULL;
+}
+
+void TextureManager::stage()
+{
+    // the largest on screen are decoded first
+    std::stable_sort(unstaged.begin(), unstaged.end(), [](const Texture *a, const Texture *b) { return a->priority > b->priority; });
+
+    bool queued = false;
+    while (!unstaged.empty())
+    {
+        // one is always let through, however large
+        Texture &texture = *unstaged.front();
+        if (stagingBytes > 0 && stagingBytes + texture.stagingSize > STAGING_BUDGET)
+            break;
+        unstaged.pop_front();
+
+        if (!map(texture, texture.stagingSize))
+        {
+            texture.state = TEXTURE_FAILED;
+            pending--;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({&texture, -1, false});
+        queued = true;
+    }
+    if (queued)
+        wake.notify_all();
+}
+
+void TextureManager::upload(Texture &texture)
+{
+    PROFILE_SCOPE("TextureManager::upload");
+
+    // a sized internal format, so the driver doesn't pick the storage
+    GLenum format = GL_RGBA;
+    GLenum internalFormat = GL_RGBA8;
+    if (texture.channels == 1)
+    {
+        format = GL_RED;
+        internalFormat = GL_R8;
+    }
+    else if (texture.channels == 2)
+    {
+        format = GL_RG;
+        internalFormat = GL_RG8;
+    }
+    else if (texture.channels == 3)
+    {
+        format = GL_RGB;
+        internalFormat = GL_RGB8;
+    }
+
+    long long bytes = texture.stagingSize;
+    long long uploadStart = Profiler::now();
+
+    unsigned int id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // rows of RGB images are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    bindStaging(texture);
+    if (texStorage2D)
+    {
+        // the whole chain allocated once, complete from the start
+        texStorage2D(GL_TEXTURE_2D, getLevelCount(texture.width, texture.height), internalFormat, texture.width, texture.height);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture.width, texture.height, format, GL_UNSIGNED_BYTE, (void *)0);
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, texture.width, texture.height, 0, format, GL_UNSIGNED_BYTE, (void *)0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    PROBE5(texture_upload, id, texture.width, texture.height, bytes, Profiler::now() - uploadStart);
+
+    // GL keeps the buffer until the copy is done
+    release(texture);
+    texture.id = id;
+    texture.state = TEXTURE_READY;
+    // the mip chain adds a third
+    setResident(texture, bytes * 4 / 3);
+}
+
+void TextureManager::uploadBaked(Texture &texture)
+{
+    PROFILE_SCOPE("TextureManager::uploadBaked");
+
+    const Ktx2Image &image = *texture.ktx2;
+    GLenum format = getBakedFormat(image.format, compressedSupported);
+    int last = (int)image.levels.size() - 1;
+    long long bytes = texture.stagingSize;
+    long long uploadStart = Profiler::now();
+
+    unsigned int id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // the finer levels stay undefined, and take no memory, until streamed in. That
+    // needs mutable storage, so only a texture with nothing to stream is immutable.
+    bool immutable = texStorage2D && texture.coarseLevel == 0;
+    if (immutable)
+        texStorage2D(GL_TEXTURE_2D, last + 1, format, image.width, image.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.coarseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+
+    // the coarse levels, as fill() packed them
+    bindStaging(texture);
+    size_t offset = 0;
+    for (int i = texture.coarseLevel; i <= last; ++i)
+    {
+        const Ktx2Level &level = image.levels[i];
+        defineLevel(image.format, format, i, level.width, level.height, level.size, (const void *)offset, immutable);
+        offset += level.size;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    PROBE5(texture_upload, id, image.levels[texture.coarseLevel].width, image.levels[texture.coarseLevel].height, bytes,
+           Profiler::now() - uploadStart);
+
+    release(texture);
+    texture.id = id;
+    texture.state = TEXTURE_READY;
+    setResident(texture, bytes);
+}
+
+void TextureManager::uploadLevel(Texture &texture, int level)
+{
+    PROFILE_SCOPE("TextureManager::uploadLevel");
+
+    const Ktx2Level &info = texture.ktx2->levels[level];
+    // only the next finer level keeps the chain complete
+    if (level == texture.residentLevel - 1)
+    {
+        GLenum format = getBakedFormat(texture.ktx2->format, compressedSupported);
+        long long uploadStart = Profiler::now();
+
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        bindStaging(texture);
+        defineLevel(texture.ktx2->format, format, level, info.width, info.height, info.size, (const void *)0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        // keep sampling the previous level, stream() lowers this to 0
+        texture.fade = 1.0f;
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, texture.fade);
+        PROBE5(texture_upload, texture.id, info.width, info.height, info.size, Profiler::now() - uploadStart);
+
+        texture.residentLevel = level;
+        setResident(texture, texture.residentBytes + info.size);
+    }
+    release(texture);
+}
+
+void TextureManager::stream()
+{
+    PROFILE_SCOPE("TextureManager::stream");
+
+    std::vector<Texture *> loading;
+    std::vector<Texture *> wanting;
+    for (Texture *texture : textures)
+    {
+        // requested while the last frame was drawn
+        if (texture->requested > 0.0f)
+            texture->lastUsed = frame;
+        if (texture->state == TEXTURE_LOADING)
+        {
+            texture->priority = texture->requested;
+        }
+        else if (texture->state == TEXTURE_UNLOADED || texture->state == TEXTURE_EVICTED)
+        {
+            // too small to show more than the placeholder; no viewport height, no way to tell
+            texture->priority = texture->requested;
+            if (texture->requested > 0.0f && (viewportHeight == 0 || texture->requested * viewportHeight >= LOAD_SIZE))
+                loading.push_back(texture);
+        }
+        // the state first: a worker may still be writing the other fields of a texture that isn't ready
+        if (texture->state != TEXTURE_READY || !texture->ktx2)
+        {
+            texture->requested = 0.0f;
+            continue;
+        }
+
+        texture->wantedLevel = getWantedLevel(*texture);
+        texture->requested = 0.0f;
+
+        if (texture->fade > 0.0f)
+        {
+            texture->fade = texture->fade > 1.0f / FADE_FRAMES ? texture->fade - 1.0f / FADE_FRAMES : 0.0f;
+            glBindTexture(GL_TEXTURE_2D, texture->id);
+            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, texture->fade);
+        }
+
+        if (texture->wantedLevel > texture->residentLevel)
+        {
+            // one level at a time, so a body that keeps moving in and out doesn't thrash
+            if (++texture->unusedFrames >= EVICT_FRAMES && evict(*texture))
+                texture->unusedFrames = 0;
+        }
+        else
+        {
+            texture->unusedFrames = 0;
+            if (texture->wantedLevel < texture->residentLevel && texture->loadingLevel < 0)
+                wanting.push_back(texture);
+        }
+    }
+
+    // the largest on screen first
+    std::sort(loading.begin(), loading.end(), [](const Texture *a, const Texture *b) { return a->priority > b->priority; });
+    for (Texture *texture : loading)
+        enqueue(*texture);
+
+    // over budget, e.g. after loads: nothing to add, only what can be dropped
+    if (makeRoom(0))
+    {
+        reportedFull = false;
+    }
+    else if (!reportedFull)
+    {
+        std::cout << "Texture budget of " << residencyBudget / (1 << 20) << " MB is too small for the visible textures" << std::endl;
+        reportedFull = true;
+    }
+
+    // the textures furthest from the detail they need go first
+    std::sort(wanting.begin(), wanting.end(), [](const Texture *a, const Texture *b) {
+        return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel;
+    });
+
+    for (Texture *texture : wanting)
+    {
+        int level = texture->residentLevel - 1;
+        long long bytes = texture->ktx2->levels[level].size;
+
+        if (!makeRoom(bytes))
+            continue;
+        if (stagingBytes > 0 && stagingBytes + bytes > STAGING_BUDGET)
+            break;
+        if (!map(*texture, bytes))
+        {
+            texture->finestLevel = texture->residentLevel;
+            continue;
+        }
+
+        texture->loadingLevel = level;
+        loadingBytes += bytes;
+        streaming++;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back({texture, level, false});
+        }
+        wake.notify_one();
+    }
+}
+
+int TextureManager::getWantedLevel(const Texture &texture) const
+{
+    // a sphere shows half of its map's width, and all of its height, across its disk
+    float pixels = texture.requested * viewportHeight;
+    int level = texture.coarseLevel;
+    while (level > texture.finestLevel)
+    {
+        const Ktx2Level &current = texture.ktx2->levels[level];
+        if (current.width / 2 >= pixels && current.height >= pixels)
+            break;
+        level--;
+    }
+    return level;
+}
+
+// Drops what nothing needs right now until bytes more fit in the budget: detail
+// beyond what a texture's body wants, then, least recently used first, the
+// streamed levels of textures nothing drew last frame, then those textures.
+bool TextureManager::makeRoom(long long bytes)
+{
+    if (residentBytes + loadingBytes + bytes <= residencyBudget)
+        return true;
+
+    for (Texture *texture : textures)
+    {
+        // the level fields of a loading texture belong to the worker reading its header
+        if (texture->state != TEXTURE_READY)
+            continue;
+        while (texture->wantedLevel > texture->residentLevel && residentBytes + loadingBytes + bytes > residencyBudget && evict(*texture))
+            ;
+    }
+    if (residentBytes + loadingBytes + bytes <= residencyBudget)
+        return true;
+
+    std::vector<Texture *> unused;
+    for (Texture *texture : textures)
+    {
+        if (texture->state == TEXTURE_READY && texture->lastUsed < frame)
+            unused.push_back(texture);
+    }
+    std::sort(unused.begin(), unused.end(), [](const Texture *a, const Texture *b) { return a->lastUsed < b->lastUsed; });
+
+    for (Texture *texture : unused)
+    {
+        while (residentBytes + loadingBytes + bytes > residencyBudget && evict(*texture))
+            ;
+    }
+    for (size_t i = 0; i < unused.size() && residentBytes + loadingBytes + bytes > residencyBudget; ++i)
+        unload(*unused[i]);
+
+    return residentBytes + loadingBytes + bytes <= residencyBudget;
+}
+
+bool TextureManager::evict(Texture &texture)
+{
+    if (texture.state != TEXTURE_READY || !texture.ktx2 || texture.loadingLevel >= 0 || texture.residentLevel >= texture.coarseLevel)
+        return false;
+
+    int level = texture.residentLevel;
+    const Ktx2Level &info = texture.ktx2->levels[level];
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    texture.fade = 0.0f;
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_LOD, 0.0f);
+    // a zero sized image frees the level's storage
+    defineLevel(texture.ktx2->format, getBakedFormat(texture.ktx2->format, compressedSupported), level, 0, 0, 0, NULL);
+
+    texture.residentLevel = level + 1;
+    setResident(texture, texture.residentBytes - info.size);
+    return true;
+}
+
+bool TextureManager::unload(Texture &texture)
+{
+    if (texture.state != TEXTURE_READY || texture.loadingLevel >= 0)
+        return false;
+
+    setResident(texture, 0);
+    MemoryStats::untrackGpu(MEM_TEXTURE, texture.id);
+    glDeleteTextures(1, &texture.id);
+    texture.id = placeholder;
+    texture.state = TEXTURE_EVICTED;
+
+    // read again from scratch, the file may have been rebaked since
+    release(texture);
+    delete texture.ktx2;
+    texture.ktx2 = NULL;
+    texture.packed = NULL;
+    texture.baked = false;
+    texture.residentLevel = texture.coarseLevel = texture.finestLevel = texture.wantedLevel = 0;
+    texture.unusedFrames = 0;
+    texture.fade = 0.0f;
+    return true;
+}
+
+void TextureManager::setResident(Texture &texture, long long bytes)
+{
+    residentBytes += bytes - texture.residentBytes;
+    texture.residentBytes = bytes;
+    MemoryStats::trackGpu(MEM_TEXTURE, texture.id, bytes);
+}
+
+void TextureManager::release(Texture &texture)
+{
+    if (texture.staging)
+    {
+        if (texture.stagingData)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture.staging);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        MemoryStats::untrackGpu(MEM_TRANSIENT, texture.staging);
+        glDeleteBuffers(1, &texture.staging);
+        stagingBytes -= texture.stagingSize;
+    }
+    texture.staging = 0;
+    texture.stagingData = NULL;
+    texture.stagingSize = 0;
+}
+
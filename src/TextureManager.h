@@ -0,0 +1,190 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Ktx2.h"
+
+enum TextureState
+{
+    TEXTURE_UNLOADED, // no body has asked for it yet
+    TEXTURE_LOADING,  // reading, decoding, or waiting for the upload
+    TEXTURE_READY,
+    TEXTURE_FAILED,
+    TEXTURE_EVICTED // dropped for the budget, loaded again once a body asks for it
+};
+
+// A texture map that may not be loaded yet. getId() is the shared placeholder
+// until the image has been decoded and uploaded, so bodies can always bind it.
+class Texture
+{
+public:
+    const std::string &getPath() const { return path; }
+    unsigned int getId() const { return id; }
+    TextureState getState() const { return state; } // main thread
+    bool isReady() const { return state == TEXTURE_READY; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    bool isBaked() const { return baked; } // loaded from a KTX2 file
+
+    // Screen coverage this frame, as a fraction of the viewport height; the
+    // largest request of the frame decides which mips stay resident. Bodies
+    // call it when they are drawn, which also marks the texture as used, and
+    // loads it once the body covers LOAD_SIZE pixels.
+    void request(float coverage)
+    {
+        if (coverage > requested)
+            requested = coverage;
+    }
+    int getResidentLevel() const { return residentLevel; } // finest mip on the GPU
+    int getWantedLevel() const { return wantedLevel; }
+
+private:
+    friend class TextureManager;
+
+    std::string path;
+    unsigned int id;
+    TextureState state;
+    int width;
+    int height;
+    int channels;
+    Ktx2Image *ktx2;             // the baked file's level index, kept for streaming
+    const unsigned char *packed; // the baked file inside the asset pack
+    bool baked;
+
+    // the pixel unpack buffer a worker fills, mapped on the GL thread, until uploaded
+    unsigned int staging;
+    unsigned char *stagingData;
+    long long stagingSize;
+
+    // mip streaming, baked textures only
+    int residentLevel;
+    int coarseLevel;  // this one and smaller stay resident
+    int finestLevel;  // finer levels failed to read
+    int wantedLevel;
+    int loadingLevel; // being read by a worker, -1 if none
+    int unusedFrames; // the finest resident level has not been wanted
+    float requested;
+    float priority;   // last frame's request while loading, larger first
+    float fade;       // GL_TEXTURE_MIN_LOD, blends a new level in
+    long long residentBytes;
+    long long lastUsed; // TextureManager::update() count when last requested
+};
+
+// Loads texture maps lazily, once a body is drawn large enough to show them
+// (Texture::request), the largest on screen first. load() only registers the
+// path, so a catalog of bodies that are never seen costs nothing.
+//
+// Textures are read on a pool of threads into pixel unpack buffers the GL
+// thread has mapped for them, and uploaded a few per frame. A worker first
+// reads the image's header, the GL thread then maps a buffer of the right
+// size (at most STAGING_BUDGET at a time), and the worker fills it. stb_image
+// decodes a whole image into its own buffer, which is copied in, flipped.
+// When tools/texture_baker has written a <name>.ktx2 next to the image (and,
+// for BC1/BC3, the driver takes S3TC), that file is read instead: no decode,
+// its levels are read straight into the mapped buffer, and its precomputed
+// mips are uploaded instead of calling glGenerateMipmap. Images and baked
+// files in the AssetPack are read from its mapping instead of the loose
+// files. Textures get sized internal formats, and immutable storage for their
+// whole mip chain where the driver has ARB_texture_storage (streamed ones
+// excepted, below).
+//
+// Baked textures are streamed by mip level: only the levels up to
+// COARSE_SIZE are loaded up front, and finer ones are read from the file
+// when a body covers enough of the screen to need them (Texture::request).
+// A new level is blended in through GL_TEXTURE_MIN_LOD, and the finest
+// level is dropped again (GL_TEXTURE_BASE_LEVEL raised, the level freed)
+// once it has gone unused for EVICT_FRAMES, or at once when the residency
+// budget is needed for a texture that is short of detail.
+//
+// The residency budget covers every texture. When it is exceeded, the
+// textures no body drew last frame give up GPU memory, least recently used
+// first: their streamed levels, then the whole texture (TEXTURE_EVICTED,
+// bound as the placeholder). An evicted texture is loaded again as soon as
+// a body requests it.
+//
+//   Texture *earth = textures->load("textures/earthmap1k.jpg"); // returns at once
+//   ...
+//   earth->request(coverage); // while drawing, the first one loads it
+//   textures->update();       // once per frame
+class TextureManager
+{
+public:
+    static const long long UPLOAD_BUDGET = 16 << 20;     // bytes uploaded per update()
+    static const long long RESIDENCY_BUDGET = 256 << 20; // default for setResidencyBudget
+    static const int COARSE_SIZE = 256;                  // levels this large or smaller are never streamed
+    static const int EVICT_FRAMES = 120;
+    static const long long STAGING_BUDGET = 64 << 20;    // unpack buffers mapped at once
+    static const int LOAD_SIZE = 4;                      // pixels on screen before a texture is loaded
+
+    TextureManager(int threads = 0); // 0: one per core, the GL thread excluded
+    ~TextureManager();               // needs the GL context, deletes every texture
+
+    Texture *load(const char *path); // the same path gives the same texture, loaded when first requested
+    void loadAll();                  // every texture not loaded, without waiting for requests
+    void unloadAll();                // every loaded texture, e.g. between benchmark rounds
+    void update();                   // GL thread, loads and streams mips for last frame's requests
+    void finish();                   // waits until everything loading so far is uploaded
+    int getPendingCount() const { return pending; }
+    unsigned int getPlaceholder() const { return placeholder; }
+
+    void setViewportHeight(int height) { viewportHeight = height; }
+    void setResidencyBudget(long long bytes) { residencyBudget = bytes; } // GPU bytes for all textures
+    long long getResidentBytes() const { return residentBytes; } // every texture, streamed or not
+
+private:
+    struct Job
+    {
+        Texture *texture;
+        int level; // -1 for the initial load
+        bool ok;   // set by the worker
+    };
+
+    void enqueue(Texture &texture); // the initial load, or a reload after eviction
+    void work();
+    bool readHeader(Texture &texture); // worker: the size of the staging buffer
+    bool fill(Texture &texture);       // worker: the baked file's coarse levels, or the decoded image
+    bool readLevel(const Texture &texture, int level, unsigned char *data) const;
+    bool map(Texture &texture, long long size); // a staging buffer to fill
+    void bindStaging(Texture &texture);         // unmapped, for the upload
+    void upload(Texture &texture);
+    void uploadBaked(Texture &texture);
+    void uploadLevel(Texture &texture, int level);
+    void stage(); // maps buffers for the headers read
+    void stream();
+    int getWantedLevel(const Texture &texture) const;
+    bool makeRoom(long long bytes); // false if nothing more can be dropped
+    bool evict(Texture &texture);   // drops the finest resident level
+    bool unload(Texture &texture);  // drops the whole texture
+    void setResident(Texture &texture, long long bytes);
+    void release(Texture &texture); // frees the staging buffer
+
+    std::vector<Texture *> textures;
+    std::unordered_map<std::string, Texture *> byPath;
+    unsigned int placeholder;
+    std::deque<Texture *> unstaged; // headers read, waiting for a staging buffer
+    long long stagingBytes;
+    int pending;   // initial loads, GL thread
+    int streaming; // level reads
+    bool compressedSupported;
+    int viewportHeight;
+    long long residencyBudget;
+    long long residentBytes;
+    long long loadingBytes; // levels being read
+    long long frame;        // update() calls
+    bool reportedFull;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;    // new work or stopping
+    std::condition_variable decoded; // a texture finished decoding
+    std::deque<Job> queue;
+    std::vector<Job> done;
+    bool stopping;
+};
+
+#endif
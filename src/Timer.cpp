@@ -5,6 +5,10 @@
 // This timer is able to measure the elapsed time with 1 micro-second accuracy
 // in both Windows, Linux and Unix system 
 //
+// On Linux/Unix it reads CLOCK_MONOTONIC_RAW, which is not slewed by NTP.
+// useTsc() switches every timer to the invariant TSC of x86 CPUs, calibrated
+// against the monotonic clock, for nano-second cost timestamps.
+//
 //  AUTHOR: Song Ho Ahn (song.ahn@gmail.com)
 // CREATED: 2003-01-13
 // UPDATED: 2017-03-30
@@ -14,24 +18,77 @@
 
 #include "Timer.h"
 #include <stdlib.h>
+#include <iostream>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TIMER_HAS_TSC 1
+#endif
+
+#if !defined(WIN32) && !defined(_WIN32) && !defined(CLOCK_MONOTONIC_RAW)
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+// clock backend shared by all timers
+static bool tscEnabled = false;
+static double ticksPerSec = 0;                  // 0 until the first query
+static double secPerTick = 0;
+static double nanoSecPerTick = 0;
+
+
 
 ///////////////////////////////////////////////////////////////////////////////
-// constructor
+// read the OS monotonic clock in its own ticks
 ///////////////////////////////////////////////////////////////////////////////
-Timer::Timer()
+static long long getOsTicks()
 {
 #if defined(WIN32) || defined(_WIN32)
+    LARGE_INTEGER count;
+    QueryPerformanceCounter(&count);
+    return count.QuadPart;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+
+
+static double getOsTicksPerSec()
+{
+#if defined(WIN32) || defined(_WIN32)
+    LARGE_INTEGER frequency;
     QueryPerformanceFrequency(&frequency);
-    startCount.QuadPart = 0;
-    endCount.QuadPart = 0;
+    return (double)frequency.QuadPart;
 #else
-    startCount.tv_sec = startCount.tv_usec = 0;
-    endCount.tv_sec = endCount.tv_usec = 0;
+    return 1000000000.0;
 #endif
+}
+
+
+
+static void setTicksPerSec(double frequency)
+{
+    ticksPerSec = frequency;
+    secPerTick = 1.0 / frequency;
+    nanoSecPerTick = 1000000000.0 / frequency;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// constructor
+///////////////////////////////////////////////////////////////////////////////
+Timer::Timer()
+{
+    if(ticksPerSec == 0)
+        setTicksPerSec(getOsTicksPerSec());
 
+    startCount = 0;
+    endCount = 0;
     stopped = 0;
-    startTimeInMicroSec = 0;
-    endTimeInMicroSec = 0;
 }
 
 
@@ -52,11 +109,7 @@ Timer::~Timer()
 void Timer::start()
 {
     stopped = 0; // reset stop flag
-#if defined(WIN32) || defined(_WIN32)
-    QueryPerformanceCounter(&startCount);
-#else
-    gettimeofday(&startCount, NULL);
-#endif
+    startCount = getTicks();
 }
 
 
@@ -68,57 +121,51 @@ void Timer::start()
 void Timer::stop()
 {
     stopped = 1; // set timer stopped flag
-
-#if defined(WIN32) || defined(_WIN32)
-    QueryPerformanceCounter(&endCount);
-#else
-    gettimeofday(&endCount, NULL);
-#endif
+    endCount = getTicks();
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// compute elapsed time in micro-second resolution.
-// other getElapsedTime will call this first, then convert to correspond resolution.
+// elapsed ticks since start(), or between start() and stop().
+// the getElapsedTime functions convert this with a single multiply.
 ///////////////////////////////////////////////////////////////////////////////
-double Timer::getElapsedTimeInMicroSec()
+long long Timer::getElapsedTicks()
 {
-#if defined(WIN32) || defined(_WIN32)
     if(!stopped)
-        QueryPerformanceCounter(&endCount);
+        endCount = getTicks();
 
-    startTimeInMicroSec = startCount.QuadPart * (1000000.0 / frequency.QuadPart);
-    endTimeInMicroSec = endCount.QuadPart * (1000000.0 / frequency.QuadPart);
-#else
-    if(!stopped)
-        gettimeofday(&endCount, NULL);
+    return endCount - startCount;
+}
 
-    startTimeInMicroSec = (startCount.tv_sec * 1000000.0) + startCount.tv_usec;
-    endTimeInMicroSec = (endCount.tv_sec * 1000000.0) + endCount.tv_usec;
-#endif
 
-    return endTimeInMicroSec - startTimeInMicroSec;
+
+///////////////////////////////////////////////////////////////////////////////
+// compute elapsed time in micro-second resolution.
+///////////////////////////////////////////////////////////////////////////////
+double Timer::getElapsedTimeInMicroSec()
+{
+    return getElapsedTicks() * (secPerTick * 1000000.0);
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// divide elapsedTimeInMicroSec by 1000
+// elapsed time in milli-second
 ///////////////////////////////////////////////////////////////////////////////
 double Timer::getElapsedTimeInMilliSec()
 {
-    return this->getElapsedTimeInMicroSec() * 0.001;
+    return getElapsedTicks() * (secPerTick * 1000.0);
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-// divide elapsedTimeInMicroSec by 1000000
+// elapsed time in second
 ///////////////////////////////////////////////////////////////////////////////
 double Timer::getElapsedTimeInSec()
 {
-    return this->getElapsedTimeInMicroSec() * 0.000001;
+    return getElapsedTicks() * secPerTick;
 }
 
 
@@ -130,3 +177,90 @@ double Timer::getElapsedTime()
 {
     return this->getElapsedTimeInSec();
 }
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// current tick count of the clock backend
+///////////////////////////////////////////////////////////////////////////////
+long long Timer::getTicks()
+{
+#ifdef TIMER_HAS_TSC
+    if(tscEnabled)
+        return (long long)__rdtsc();
+#endif
+    return getOsTicks();
+}
+
+
+
+double Timer::getTicksPerSec()
+{
+    if(ticksPerSec == 0)
+        setTicksPerSec(getOsTicksPerSec());
+    return ticksPerSec;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// monotonic time in nano-second. not related to the wall clock, only
+// differences between two values are meaningful.
+///////////////////////////////////////////////////////////////////////////////
+long long Timer::getNanoSec()
+{
+#if !defined(WIN32) && !defined(_WIN32)
+    if(!tscEnabled)
+        return getOsTicks(); // already in nano-second
+#endif
+    if(ticksPerSec == 0)
+        setTicksPerSec(getOsTicksPerSec());
+    return (long long)(getTicks() * nanoSecPerTick);
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// use the time stamp counter if it is invariant (constant rate in all
+// P/C-states, synchronized across cores). its rate is measured against the
+// OS clock over ~20 ms.
+///////////////////////////////////////////////////////////////////////////////
+bool Timer::useTsc()
+{
+#ifdef TIMER_HAS_TSC
+    if(tscEnabled)
+        return true;
+
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+    {
+        std::cout << "Timer: no invariant TSC, using the OS monotonic clock" << std::endl;
+        return false;
+    }
+
+    double osFrequency = getOsTicksPerSec();
+    long long osStart = getOsTicks();
+    unsigned long long tscStart = __rdtsc();
+    long long osEnd;
+    do
+    {
+        osEnd = getOsTicks();
+    } while((osEnd - osStart) < osFrequency * 0.02);
+    unsigned long long tscEnd = __rdtsc();
+
+    setTicksPerSec((tscEnd - tscStart) * osFrequency / (osEnd - osStart));
+    tscEnabled = true;
+
+    std::cout << "Timer: invariant TSC at " << ticksPerSec * 1.0e-6 << " MHz" << std::endl;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+
+bool Timer::isUsingTsc()
+{
+    return tscEnabled;
+}
@@ -5,6 +5,10 @@
 // This timer is able to measure the elapsed time with 1 micro-second accuracy
 // in both Windows, Linux and Unix system 
 //
+// On Linux/Unix it reads CLOCK_MONOTONIC_RAW, which is not slewed by NTP.
+// useTsc() switches every timer to the invariant TSC of x86 CPUs, calibrated
+// against the monotonic clock, for nano-second cost timestamps.
+//
 //  AUTHOR: Song Ho Ahn (song.ahn@gmail.com)
 // CREATED: 2003-01-13
 // UPDATED: 2017-03-30
@@ -18,7 +22,7 @@
 #if defined(WIN32) || defined(_WIN32)   // Windows system specific
 #include <windows.h>
 #else          // Unix based system specific
-#include <sys/time.h>
+#include <time.h>
 #endif
 
 
@@ -34,23 +38,23 @@ public:
     double getElapsedTimeInSec();               // get elapsed time in second (same as getElapsedTime)
     double getElapsedTimeInMilliSec();          // get elapsed time in milli-second
     double getElapsedTimeInMicroSec();          // get elapsed time in micro-second
+    long long getElapsedTicks();                // get elapsed time in ticks of the clock backend
+
+    // raw clock, cheap enough for profiling zones
+    static long long getTicks();                // current tick count of the clock backend
+    static double getTicksPerSec();             // tick frequency of the clock backend
+    static long long getNanoSec();              // monotonic time in nano-second
+    static bool useTsc();                       // switch to the invariant TSC if the CPU has one; call first, before any thread reads the clock
+    static bool isUsingTsc();
 
 
 protected:
 
 
 private:
-    double startTimeInMicroSec;                 // starting time in micro-second
-    double endTimeInMicroSec;                   // ending time in micro-second
+    long long startCount;                       // ticks at start()
+    long long endCount;                         // ticks at stop() or at the last query
     int    stopped;                             // stop flag 
-#if defined(WIN32) || defined(_WIN32)
-    LARGE_INTEGER frequency;                    // ticks per second
-    LARGE_INTEGER startCount;                   //
-    LARGE_INTEGER endCount;                     //
-#else
-    timeval startCount;                         //
-    timeval endCount;                           //
-#endif
 };
 
 #endif // TIMER_H_DEF
@@ -0,0 +1,555 @@
+#include "VirtualTexture.h"
+#include "Profiler.h"
+#include "MemoryStats.h"
+#include "DepthTarget.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// texture id, level and tile in one word: 16, 8, 20 and 20 bits
+static unsigned long long makeKey(int id, int level, int x, int y)
+{
+    return ((unsigned long long)id << 48) | ((unsigned long long)level << 40) | ((unsigned long long)y << 20) | (unsigned long long)x;
+}
+
+static int getKeyId(unsigned long long key) { return (int)(key >> 48); }
+static int getKeyLevel(unsigned long long key) { return (int)((key >> 40) & 0xFF); }
+static int getKeyY(unsigned long long key) { return (int)((key >> 20) & 0xFFFFF); }
+static int getKeyX(unsigned long long key) { return (int)(key & 0xFFFFF); }
+
+VirtualTexture::VirtualTexture(const char *path, int id) : path(path), id(id), pageTable(0), residentTiles(0), dirty(false)
+{
+}
+
+VirtualTexture::~VirtualTexture()
+{
+    if (pageTable)
+    {
+        MemoryStats::untrackGpu(MEM_TEXTURE, pageTable);
+        glDeleteTextures(1, &pageTable);
+    }
+}
+
+void VirtualTexture::createPageTable()
+{
+    int levels = file.getLevelCount();
+    slots.resize(levels);
+
+    glGenTextures(1, &pageTable);
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    long long bytes = 0;
+    for (int level = 0; level < levels; ++level)
+    {
+        int tilesX = file.getTilesX(level), tilesY = file.getTilesY(level);
+        slots[level].assign(tilesX * tilesY, -1);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, tilesX, tilesY, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        bytes += (long long)tilesX * tilesY * 4;
+    }
+    MemoryStats::trackGpu(MEM_TEXTURE, pageTable, bytes);
+}
+
+void VirtualTexture::rebuild()
+{
+    PROFILE_SCOPE("VirtualTexture::rebuild");
+
+    // coarsest first, so a missing tile can take its parent's entry
+    int levels = file.getLevelCount();
+    std::vector<std::vector<unsigned char>> entries(levels);
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+    for (int level = levels - 1; level >= 0; --level)
+    {
+        int tilesX = file.getTilesX(level), tilesY = file.getTilesY(level);
+        entries[level].resize((size_t)tilesX * tilesY * 4);
+        for (int y = 0; y < tilesY; ++y)
+        {
+            for (int x = 0; x < tilesX; ++x)
+            {
+                unsigned char *entry = &entries[level][((size_t)y * tilesX + x) * 4];
+                int slot = slots[level][y * tilesX + x];
+                if (slot >= 0)
+                {
+                    entry[0] = (unsigned char)(slot % VirtualTextureCache::CACHE_TILES);
+                    entry[1] = (unsigned char)(slot / VirtualTextureCache::CACHE_TILES);
+                    entry[2] = (unsigned char)level;
+                    entry[3] = 255;
+                }
+                else if (level + 1 < levels)
+                {
+                    const unsigned char *parent = &entries[level + 1][((size_t)(y / 2) * file.getTilesX(level + 1) + x / 2) * 4];
+                    std::copy(parent, parent + 4, entry);
+                }
+                else
+                {
+                    std::fill(entry, entry + 4, 0);
+                }
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, tilesX, tilesY, GL_RGBA, GL_UNSIGNED_BYTE, entries[level].data());
+    }
+    dirty = false;
+}
+
+void VirtualTexture::setUniforms(const Shader &shader) const
+{
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, pageTable);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setBool("virtualTexture", true);
+    shader.setVec2("vtSize", glm::vec2((float)file.getWidth(), (float)file.getHeight()));
+    shader.setInt("vtLevels", file.getLevelCount());
+    shader.setInt("vtId", id);
+}
+
+VirtualTextureCache::VirtualTextureCache(int width, int height)
+    : frame(0), reportedFull(false), width(width), height(height), feedbackFBO(0), feedbackColor(0), feedbackDepth(0),
+      feedbackIndex(0), stopping(false)
+{
+    int size = CACHE_TILES * PageFile::TILE_STRIDE;
+    glGenTextures(1, &cacheTexture);
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    MemoryStats::trackGpu(MEM_TEXTURE, cacheTexture, (long long)size * size * 4);
+
+    slots.resize(CACHE_TILES * CACHE_TILES);
+    for (int i = (int)slots.size() - 1; i >= 0; --i)
+        freeSlots.push_back(i);
+
+    glGenBuffers(2, feedbackPBO);
+    feedbackFence[0] = feedbackFence[1] = 0;
+    createFeedbackTarget();
+    feedbackShaders[0] = new Shader("shaders/planet.vs", "shaders/vt_feedback.fs");
+    feedbackShaders[1] = new Shader("shaders/planet.vs", "shaders/vt_feedback.fs", DepthTarget::LOG_DEPTH_DEFINES);
+
+    loader = std::thread(&VirtualTextureCache::work, this);
+}
+
+VirtualTextureCache::~VirtualTextureCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    loader.join();
+
+    for (const Tile &tile : done)
+        MemoryStats::addCpu(MEM_TRANSIENT, -(long long)tile.data.size());
+    for (VirtualTexture *texture : textures)
+        delete texture;
+
+    deleteFeedbackTarget();
+    glDeleteBuffers(2, feedbackPBO);
+    for (Shader *shader : feedbackShaders)
+    {
+        glDeleteProgram(shader->ID);
+        delete shader;
+    }
+    MemoryStats::untrackGpu(MEM_TEXTURE, cacheTexture);
+    glDeleteTextures(1, &cacheTexture);
+}
+
+VirtualTexture *VirtualTextureCache::open(const char *path)
+{
+    for (VirtualTexture *texture : textures)
+    {
+        if (texture->path == path)
+            return texture;
+    }
+
+    VirtualTexture *texture = new VirtualTexture(path, (int)textures.size() + 1);
+    if (!texture->file.open(path))
+    {
+        delete texture;
+        return NULL;
+    }
+
+    texture->createPageTable();
+    if (!loadPinned(*texture))
+    {
+        delete texture;
+        return NULL;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        textures.push_back(texture);
+    }
+    texture->rebuild();
+    return texture;
+}
+
+bool VirtualTextureCache::loadPinned(VirtualTexture &texture)
+{
+    // the last level fits in a single tile
+    if (freeSlots.empty())
+    {
+        std::cout << "No room in the virtual texture cache for " << texture.path << std::endl;
+        return false;
+    }
+
+    Tile tile;
+    int top = texture.file.getLevelCount() - 1;
+    tile.key = makeKey(texture.id, top, 0, 0);
+    if (!texture.file.readTile(top, 0, 0, tile.data))
+    {
+        std::cout << "Failed to read virtual texture: " << texture.path << std::endl;
+        return false;
+    }
+    return place(texture, tile, true);
+}
+
+void VirtualTextureCache::resize(int w, int h)
+{
+    width = w;
+    height = h;
+    createFeedbackTarget();
+}
+
+void VirtualTextureCache::createFeedbackTarget()
+{
+    deleteFeedbackTarget();
+
+    int w = std::max(width / FEEDBACK_SCALE, 1), h = std::max(height / FEEDBACK_SCALE, 1);
+
+    glGenTextures(1, &feedbackColor);
+    glBindTexture(GL_TEXTURE_2D, feedbackColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, w, h, 0, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenRenderbuffers(1, &feedbackDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    MemoryStats::trackGpu(MEM_TARGET, feedbackColor, (long long)w * h * 8);
+    MemoryStats::trackGpu(MEM_TARGET, feedbackDepth, (long long)w * h * 4);
+
+    glGenFramebuffers(1, &feedbackFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::VIRTUAL_TEXTURE::FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBO[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (long long)w * h * 8, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void VirtualTextureCache::deleteFeedbackTarget()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        if (feedbackFence[i])
+            glDeleteSync(feedbackFence[i]);
+        feedbackFence[i] = 0;
+    }
+
+    if (!feedbackFBO)
+        return;
+
+    MemoryStats::untrackGpu(MEM_TARGET, feedbackColor);
+    MemoryStats::untrackGpu(MEM_TARGET, feedbackDepth);
+    glDeleteFramebuffers(1, &feedbackFBO);
+    glDeleteTextures(1, &feedbackColor);
+    glDeleteRenderbuffers(1, &feedbackDepth);
+    feedbackFBO = feedbackColor = feedbackDepth = 0;
+}
+
+Shader &VirtualTextureCache::beginFeedback(bool logDepth)
+{
+    int w = std::max(width / FEEDBACK_SCALE, 1), h = std::max(height / FEEDBACK_SCALE, 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBO);
+    glViewport(0, 0, w, h);
+
+    // the depth clear value and test are still those of the depth mode
+    static const GLuint none[4] = {0, 0, 0, 0};
+    glClearBufferuiv(GL_COLOR, 0, none);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    Shader &shader = *feedbackShaders[logDepth ? 1 : 0];
+    shader.use();
+    // derivatives are FEEDBACK_SCALE times larger here than on screen
+    shader.setFloat("lodBias", -std::log2((float)FEEDBACK_SCALE));
+    shader.setFloat("vtTileSize", (float)PageFile::TILE_SIZE);
+    return shader;
+}
+
+void VirtualTextureCache::endFeedback()
+{
+    int w = std::max(width / FEEDBACK_SCALE, 1), h = std::max(height / FEEDBACK_SCALE, 1);
+
+    // read back into the PBO now, map it a frame later once the fence has passed
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBO[feedbackIndex]);
+    glReadPixels(0, 0, w, h, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, (void *)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (feedbackFence[feedbackIndex])
+        glDeleteSync(feedbackFence[feedbackIndex]);
+    feedbackFence[feedbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    feedbackSize[feedbackIndex][0] = w;
+    feedbackSize[feedbackIndex][1] = h;
+    feedbackIndex ^= 1;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+void VirtualTextureCache::setUniforms(const Shader &shader) const
+{
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("pageTable", 1);
+    shader.setInt("tileCache", 2);
+    shader.setFloat("vtTileSize", (float)PageFile::TILE_SIZE);
+    shader.setFloat("vtBorder", (float)PageFile::BORDER);
+    shader.setFloat("vtCacheSize", (float)(CACHE_TILES * PageFile::TILE_STRIDE));
+}
+
+void VirtualTextureCache::update()
+{
+    if (textures.empty())
+        return;
+
+    PROFILE_SCOPE("VirtualTextureCache::update");
+    frame++;
+    readFeedback();
+
+    std::vector<Tile> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(done);
+    }
+
+    int uploaded = 0;
+    for (size_t i = 0; i < ready.size(); ++i)
+    {
+        if (uploaded >= UPLOADS_PER_FRAME)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.insert(done.begin(), std::make_move_iterator(ready.begin() + i), std::make_move_iterator(ready.end()));
+            break;
+        }
+
+        Tile &tile = ready[i];
+        VirtualTexture &texture = *getTexture(tile.key);
+        if (tile.data.empty())
+        {
+            // left pending, so it is not asked for again
+            std::cout << "Failed to read virtual texture tile: " << texture.path << " level " << getKeyLevel(tile.key) << std::endl;
+            continue;
+        }
+
+        pending.erase(tile.key);
+        MemoryStats::addCpu(MEM_TRANSIENT, -(long long)tile.data.size());
+        if (place(texture, tile, false))
+            uploaded++;
+    }
+
+    for (VirtualTexture *texture : textures)
+    {
+        if (texture->dirty)
+            texture->rebuild();
+    }
+}
+
+void VirtualTextureCache::readFeedback()
+{
+    GLsync fence = feedbackFence[feedbackIndex];
+    if (!fence)
+        return;
+    // the older of the two read backs; skipped rather than waited for if the GPU is behind
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return;
+    glDeleteSync(fence);
+    feedbackFence[feedbackIndex] = 0;
+
+    PROFILE_SCOPE("VirtualTextureCache::readFeedback");
+
+    int w = feedbackSize[feedbackIndex][0], h = feedbackSize[feedbackIndex][1];
+    std::vector<unsigned long long> needed;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedbackPBO[feedbackIndex]);
+    const unsigned short *texels = (const unsigned short *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (long long)w * h * 8, GL_MAP_READ_BIT);
+    if (texels)
+    {
+        for (int i = 0; i < w * h; ++i)
+        {
+            const unsigned short *texel = texels + i * 4;
+            int id = texel[3], level = texel[2];
+            if (id == 0 || id > (int)textures.size())
+                continue;
+            const PageFile &file = textures[id - 1]->file;
+            if (level < file.getLevelCount() && texel[0] < file.getTilesX(level) && texel[1] < file.getTilesY(level))
+                needed.push_back(makeKey(id, level, texel[0], texel[1]));
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::sort(needed.begin(), needed.end());
+    needed.erase(std::unique(needed.begin(), needed.end()), needed.end());
+
+    // requests not started yet are replaced by this frame's
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (unsigned long long key : queue)
+            pending.erase(key);
+        queue.clear();
+    }
+
+    std::vector<unsigned long long> missing;
+    for (unsigned long long key : needed)
+        request(key, missing);
+
+    // coarse levels first, they cover the most pixels until the rest arrives
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    std::stable_sort(missing.begin(), missing.end(),
+                     [](unsigned long long a, unsigned long long b) { return getKeyLevel(a) > getKeyLevel(b); });
+    if ((int)missing.size() > REQUESTS_PER_FRAME)
+        missing.resize(REQUESTS_PER_FRAME);
+
+    if (!missing.empty())
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (unsigned long long key : missing)
+        {
+            pending.insert(key);
+            queue.push_back(key);
+        }
+    }
+    wake.notify_one();
+}
+
+// marks a needed tile and its parents as used, collects those not resident
+void VirtualTextureCache::request(unsigned long long key, std::vector<unsigned long long> &missing)
+{
+    int id = getKeyId(key), x = getKeyX(key), y = getKeyY(key);
+    int levels = textures[id - 1]->file.getLevelCount();
+    for (int level = getKeyLevel(key); level < levels; ++level, x /= 2, y /= 2)
+    {
+        unsigned long long tile = makeKey(id, level, x, y);
+        auto it = resident.find(tile);
+        if (it != resident.end())
+        {
+            Slot &slot = slots[it->second];
+            if (slot.lastUsed == frame)
+                break; // so are its parents
+            slot.lastUsed = frame;
+            if (!slot.pinned)
+                lru.splice(lru.begin(), lru, slot.lru);
+        }
+        else if (!pending.count(tile))
+        {
+            missing.push_back(tile);
+        }
+    }
+}
+
+bool VirtualTextureCache::place(VirtualTexture &texture, const Tile &tile, bool pinned)
+{
+    int slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        // never evict what the last feedback asked for
+        if (lru.empty() || slots[lru.back()].lastUsed == frame)
+        {
+            if (!reportedFull)
+                std::cout << "Virtual texture cache full, the screen needs more than " << CACHE_TILES * CACHE_TILES << " tiles" << std::endl;
+            reportedFull = true;
+            return false;
+        }
+
+        slot = lru.back();
+        lru.pop_back();
+        unsigned long long old = slots[slot].key;
+        VirtualTexture &owner = *getTexture(old);
+        int level = getKeyLevel(old);
+        owner.slots[level][getKeyY(old) * owner.file.getTilesX(level) + getKeyX(old)] = -1;
+        owner.residentTiles--;
+        owner.dirty = true;
+        resident.erase(old);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % CACHE_TILES) * PageFile::TILE_STRIDE, (slot / CACHE_TILES) * PageFile::TILE_STRIDE,
+                    PageFile::TILE_STRIDE, PageFile::TILE_STRIDE, GL_RGBA, GL_UNSIGNED_BYTE, tile.data.data());
+
+    Slot &entry = slots[slot];
+    entry.key = tile.key;
+    entry.lastUsed = frame;
+    entry.pinned = pinned;
+    if (!pinned)
+    {
+        lru.push_front(slot);
+        entry.lru = lru.begin();
+    }
+    resident[tile.key] = slot;
+
+    int level = getKeyLevel(tile.key);
+    texture.slots[level][getKeyY(tile.key) * texture.file.getTilesX(level) + getKeyX(tile.key)] = slot;
+    texture.residentTiles++;
+    texture.dirty = true;
+    return true;
+}
+
+VirtualTexture *VirtualTextureCache::getTexture(unsigned long long key) const
+{
+    return textures[getKeyId(key) - 1];
+}
+
+void VirtualTextureCache::work()
+{
+    Profiler::setThreadName("virtual texture loader");
+
+    for (;;)
+    {
+        Tile tile;
+        VirtualTexture *texture;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            tile.key = queue.front();
+            queue.pop_front();
+            texture = getTexture(tile.key);
+        }
+
+        {
+            PROFILE_SCOPE("VirtualTextureCache::readTile");
+            if (texture->file.readTile(getKeyLevel(tile.key), getKeyX(tile.key), getKeyY(tile.key), tile.data))
+                MemoryStats::addCpu(MEM_TRANSIENT, tile.data.size());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.push_back(std::move(tile));
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "PageFile.h"
+#include "Shader.h"
+
+// One page file as seen by the shaders: an indirection texture with a texel
+// per tile and a mip per page file level, each pointing at the finest
+// resident tile that covers it (its slot in the tile cache and its level).
+class VirtualTexture
+{
+public:
+    const std::string &getPath() const { return path; }
+    int getId() const { return id; }
+    int getResidentTiles() const { return residentTiles; }
+
+    // binds the indirection texture, for planet.fs and vt_feedback.fs
+    void setUniforms(const Shader &shader) const;
+
+private:
+    friend class VirtualTextureCache;
+
+    VirtualTexture(const char *path, int id);
+    ~VirtualTexture();
+    void createPageTable();
+    void rebuild(); // after tiles came or went
+
+    std::string path;
+    int id; // 1-based, 0 marks empty feedback texels
+    PageFile file;
+    unsigned int pageTable;
+    std::vector<std::vector<int>> slots; // per level and tile, -1 if not resident
+    int residentTiles;
+    bool dirty;
+};
+
+// Virtual texturing for surface maps that can never be fully resident.
+// A low resolution feedback pass renders, for every pixel, the tile and level
+// it needs; update() reads that back a frame later (through a fenced PBO, so it
+// never waits for the GPU), streams the missing tiles from the page files on a
+// loader thread, and places them in one fixed size physical tile cache, least
+// recently used out. GPU memory is the cache plus the indirection textures,
+// set by the screen size rather than by the size of the maps.
+//
+//   VirtualTexture *earth = virtualTextures->open("textures/earthmap1k.vtex"); // NULL if there is none
+//   ...
+//   virtualTextures->update(); // once per frame
+//   Shader &feedback = virtualTextures->beginFeedback(depthTarget->isLogarithmic());
+//   ... draw the bodies with virtual textures ...
+//   virtualTextures->endFeedback();
+class VirtualTextureCache
+{
+public:
+    static const int CACHE_TILES = 16; // per side: 256 tiles, 2176x2176 RGBA8
+    static const int FEEDBACK_SCALE = 8;
+    static const int UPLOADS_PER_FRAME = 16;
+    static const int REQUESTS_PER_FRAME = 64;
+
+    VirtualTextureCache(int width, int height); // needs the GL context
+    ~VirtualTextureCache();
+
+    VirtualTexture *open(const char *path); // the same path gives the same texture
+    bool isEmpty() const { return textures.empty(); }
+    void resize(int width, int height);
+
+    void update(); // GL thread: feedback from the last frame, tile uploads
+    void setUniforms(const Shader &shader) const;
+
+    Shader &beginFeedback(bool logDepth); // binds the feedback target and shader, the LOG_DEPTH variant if logDepth
+    void endFeedback();      // queues the read back, restores the default framebuffer
+
+    int getResidentTiles() const { return (int)resident.size(); }
+    int getPendingTiles() const { return (int)pending.size(); }
+
+private:
+    struct Tile
+    {
+        unsigned long long key;
+        std::vector<unsigned char> data;
+    };
+
+    struct Slot
+    {
+        unsigned long long key;
+        long long lastUsed; // frame
+        bool pinned;        // a texture's coarsest level, always resident
+        std::list<int>::iterator lru;
+    };
+
+    void work();
+    void createFeedbackTarget();
+    void deleteFeedbackTarget();
+    void readFeedback();
+    void request(unsigned long long key, std::vector<unsigned long long> &missing);
+    bool place(VirtualTexture &texture, const Tile &tile, bool pinned);
+    bool loadPinned(VirtualTexture &texture);
+    VirtualTexture *getTexture(unsigned long long key) const;
+
+    std::vector<VirtualTexture *> textures;
+    unsigned int cacheTexture;
+    std::vector<Slot> slots;
+    std::vector<int> freeSlots;
+    std::list<int> lru; // most recently used first, pinned slots excluded
+    std::unordered_map<unsigned long long, int> resident;
+    std::unordered_set<unsigned long long> pending; // requested, not placed yet
+    long long frame;
+    bool reportedFull;
+
+    int width, height;
+    unsigned int feedbackFBO, feedbackColor, feedbackDepth;
+    unsigned int feedbackPBO[2];
+    GLsync feedbackFence[2];
+    int feedbackSize[2][2];
+    int feedbackIndex;
+    Shader *feedbackShaders[2]; // plain and LOG_DEPTH
+
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<unsigned long long> queue;
+    std::vector<Tile> done;
+    bool stopping;
+};
+
+#endif
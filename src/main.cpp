@@ -10,7 +10,24 @@
 #include "Sphere.h"
 #include "ModernSphere.h"
 #include "Timer.h"
+#include "DepthTarget.h"
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "Benchmark.h"
+#include "SceneGenerator.h"
+#include "Frustum.h"
+#include "MemoryStats.h"
+#include "Telemetry.h"
+#include "Probes.h"
+#include "GlStats.h"
+#include "StallDetector.h"
+#include "TextureManager.h"
+#include "VirtualTexture.h"
+#include "AssetPack.h"
 #include <iostream>
+#include <csignal>
+#include <cstring>
 #include <vector>
 
 using namespace std;
@@ -19,10 +36,24 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+void create_solar_system();
+void open_virtual_textures(Planet *planet);
+void request_stats_dump(int signal);
+void dump_frame_stats();
+void publish_telemetry(Telemetry &telemetry, const GpuProfiler &gpuProfiler, const ModernSphere &sphere, double time,
+                       double frameMs, double cpuMs, double presentMs);
 
 const unsigned int SCR_WIDTH = 1200;
 const unsigned int SCR_HEIGHT = 900;
 
+// build the sphere in the vertex shader instead of uploading a mesh
+const bool PROCEDURAL_SPHERE = true;
+const int SPHERE_SECTORS = 36;
+const int SPHERE_STACKS = 18;
+
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 1000.0f;
+
 Camera camera(glm::vec3(0.0f, 0.0f, 160.0f));
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
@@ -30,17 +61,48 @@ bool firstMouse = true;
 
 Timer timer;
 float deltaTime = 0.0f;
-float lastFrame = 0.0f;
+double lastFrame = 0.0;
+
+FrameStats frameStats;
+volatile sig_atomic_t statsDumpRequested = 0;
+double lastOverlayUpdate = 0.0;
+
+DepthTarget *depthTarget;
+TextureManager *textureManager;
+VirtualTextureCache *virtualTextures;
+bool depthKeyPressed = false;
+bool traceKeyPressed = false;
 
 Planet *sun;
 vector<Planet *> planets;
+unsigned int bodyCount = 0; // sun, planets and moons
 
-int main()
+int main(int argc, char **argv)
 {
+    Profiler::setThreadName("main");
+
+    BenchmarkOptions benchmarkOptions;
+    if (!Benchmark::parseArgs(argc, argv, benchmarkOptions))
+        return -1;
+    // before any thread or profiling zone reads the clock: the backend is
+    // not synchronized, and zones of two time bases can't share a trace
+    if (benchmarkOptions.tsc)
+        Timer::useTsc();
+    Benchmark *benchmark = benchmarkOptions.enabled ? new Benchmark(benchmarkOptions) : NULL;
+    if (benchmark && !benchmark->load())
+        return -1;
+
+    // loose files otherwise, see tools/asset_packer
+    AssetPack::mount("assets.pak");
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // benchmarks render offscreen, e.g. on Mesa llvmpipe in CI
+    if (benchmark)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    StallDetector::setWindowHints();
 
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Solar System", NULL, NULL);
     if (window == NULL)
@@ -52,93 +114,181 @@ int main()
     glfwMakeContextCurrent(window);
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (benchmark)
+    {
+        // no input and no vsync, the frame rate is what we measure
+        glfwSwapInterval(0);
+    }
+    else
+    {
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         cout << "Failed to initialize GLAD" << endl;
         return -1;
     }
+    GlStats::install();
+    StallDetector::install(); // after GlStats, so its call sites are ours
 
     glEnable(GL_DEPTH_TEST);
 
-    Shader planetShader("shaders/planet.vs", "shaders/planet.fs");
-    Shader sunShader("shaders/sun.vs", "shaders/sun.fs");
-
-    Sphere sphereModel(1.0f, 36, 18, true);
-    ModernSphere modernSphere(sphereModel);
-
-    // Create the sun
-    sun = new Planet(0.0f, 0.0f, 10.0f, 8.0f, "textures/sunmap.jpg");
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    depthTarget = new DepthTarget(fbWidth, fbHeight);
+    depthTarget->setMode(DepthTarget::bestMode());
+
+    GpuProfiler *gpuProfiler = new GpuProfiler();
+    textureManager = new TextureManager();
+    textureManager->setViewportHeight(fbHeight);
+    if (benchmarkOptions.textureBudgetMB > 0)
+        textureManager->setResidencyBudget((long long)benchmarkOptions.textureBudgetMB << 20);
+    unsigned int gpuFrameSamples = 0;
+
+    // the LOG_DEPTH variants write gl_FragDepth, for DEPTH_LOGARITHMIC only
+    Shader planetShaderPlain("shaders/planet.vs", "shaders/planet.fs");
+    Shader sunShaderPlain("shaders/sun.vs", "shaders/sun.fs");
+    Shader planetShaderLog("shaders/planet.vs", "shaders/planet.fs", DepthTarget::LOG_DEPTH_DEFINES);
+    Shader sunShaderLog("shaders/sun.vs", "shaders/sun.fs", DepthTarget::LOG_DEPTH_DEFINES);
+
+    ModernSphere *sphere;
+    if (PROCEDURAL_SPHERE)
+    {
+        sphere = new ModernSphere(SPHERE_SECTORS, SPHERE_STACKS);
+    }
+    else
+    {
+        Sphere sphereModel(1.0f, SPHERE_SECTORS, SPHERE_STACKS, true);
+        sphere = new ModernSphere(sphereModel);
+    }
+    ModernSphere &modernSphere = *sphere;
 
-    // creating 9 planets
-    // Mercury
-    Planet *mercury = new Planet(15.0f, 47.0f, 20.0f, 0.8f, "textures/mercurymap.jpg");
-    planets.push_back(mercury);
+    if (benchmarkOptions.sweepBodies > 0)
+    {
+        glm::mat4 projection = depthTarget->getProjection(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+        depthTarget->begin(glm::vec4(0.0f, 0.0f, 0.05f, 1.0f));
+        Shader &planetShader = depthTarget->isLogarithmic() ? planetShaderLog : planetShaderPlain;
+        planetShader.use();
+        depthTarget->setUniforms(planetShader);
+        SceneGenerator::sweep(benchmarkOptions.sweepBodies, *textureManager, planetShader, modernSphere, camera.GetViewMatrix(), projection,
+                              "scene-sweep.csv");
+
+        delete textureManager;
+        delete sphere;
+        delete depthTarget;
+        delete gpuProfiler;
+        AssetPack::unmount();
+        glfwTerminate();
+        return 0;
+    }
 
-    // Venus
-    Planet *venus = new Planet(22.0f, 35.0f, 15.0f, 1.5f, "textures/venusmap.jpg");
-    planets.push_back(venus);
+    virtualTextures = new VirtualTextureCache(fbWidth, fbHeight);
 
-    // Earth with Moon
-    Planet *earth = new Planet(30.0f, 30.0f, 25.0f, 1.6f, "textures/earthmap1k.jpg");
-    Planet *moon = new Planet(3.0f, 80.0f, 15.0f, 0.4f, "textures/moonmap1k.jpg");
-    earth->addMoon(moon);
-    planets.push_back(earth);
+    // Create the sun
+    sun = new Planet(0.0f, 0.0f, 10.0f, 8.0f, textureManager->load("textures/sunmap.jpg"));
 
-    // Mars
-    Planet *mars = new Planet(40.0f, 24.0f, 20.0f, 1.2f, "textures/marsmap1k.jpg");
-    planets.push_back(mars);
+    SceneGenerator *sceneGenerator = NULL;
+    if (benchmarkOptions.sceneBodies > 0)
+    {
+        SceneParams sceneParams;
+        sceneParams.bodyCount = benchmarkOptions.sceneBodies;
+        sceneGenerator = new SceneGenerator(sceneParams, *textureManager);
+        sceneGenerator->build(planets);
+    }
+    else
+    {
+        create_solar_system();
+    }
 
-    // Jupiter
-    Planet *jupiter = new Planet(55.0f, 13.0f, 12.0f, 4.0f, "textures/jupitermap.jpg");
-    planets.push_back(jupiter);
+    // textures/<map>.vtex from tools/texture_tiler replaces a body's map
+    for (auto planet : planets)
+        open_virtual_textures(planet);
 
-    // Saturn
-    Planet *saturn = new Planet(70.0f, 9.0f, 10.0f, 3.5f, "textures/saturnmap.png");
-    planets.push_back(saturn);
+#ifdef SIGUSR1
+    signal(SIGUSR1, request_stats_dump);
+#endif
 
-    // Uranus
-    Planet *uranus = new Planet(85.0f, 6.0f, 8.0f, 2.5f, "textures/uranusmap.png");
-    planets.push_back(uranus);
+    // textures load once their body is first drawn, and bodies render with a
+    // placeholder until then, except in benchmarks, which measure the loaded scene
+    if (benchmark)
+    {
+        textureManager->loadAll();
+        textureManager->finish();
+    }
 
-    // Neptune
-    Planet *neptune = new Planet(100.0f, 5.0f, 7.0f, 2.4f, "textures/neptunemap.jpg");
-    planets.push_back(neptune);
+    bodyCount = 1 + planets.size();
+    for (auto planet : planets)
+        bodyCount += planet->moons.size();
 
-    // Pluto
-    Planet *pluto = new Planet(115.0f, 4.0f, 5.0f, 0.6f, "textures/plutomap.png");
-    planets.push_back(pluto);
+    // live stats for external dashboards, see tools/telemetry_dump
+    Telemetry telemetry;
 
     timer.start();
+    unsigned long long frameIndex = 0;
 
-    while (!glfwWindowShouldClose(window))
+    while (!glfwWindowShouldClose(window) && !(benchmark && benchmark->isDone()))
     {
-        float currentFrame = timer.getElapsedTimeInSec();
-        deltaTime = currentFrame - lastFrame;
+        PROFILE_SCOPE("frame");
+        PROBE1(frame_begin, frameIndex);
+        MemoryStats::beginFrame();
+        GlStats::beginFrame();
+
+        double currentFrame = timer.getElapsedTimeInSec();
+        double frameMs = (currentFrame - lastFrame) * 1000.0;
+        deltaTime = (float)(currentFrame - lastFrame);
+        if (lastFrame > 0.0)
+            frameStats.record(FRAME_TOTAL, frameMs);
         lastFrame = currentFrame;
 
-        processInput(window);
+        if (benchmark)
+        {
+            benchmark->applyCamera(camera);
+            deltaTime = Benchmark::TIME_STEP;
+        }
+        else
+        {
+            processInput(window);
+        }
 
-        glClearColor(0.0f, 0.0f, 0.05f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        textureManager->update();
+        virtualTextures->update();
+        gpuProfiler->beginFrame();
+        depthTarget->begin(glm::vec4(0.0f, 0.0f, 0.05f, 1.0f));
 
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 projection = depthTarget->getProjection(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
         glm::mat4 view = camera.GetViewMatrix();
+        Frustum frustum(projection * view);
+
+        // the simulation step, ahead of drawing so the probe brackets it alone
+        long long stepStart = PROBE_ENABLED(sim_step) ? Profiler::now() : 0;
+        sun->update(deltaTime);
+        for (auto planet : planets)
+            planet->update(deltaTime);
+        if (PROBE_ENABLED(sim_step))
+            PROBE3(sim_step, frameIndex, bodyCount, Profiler::now() - stepStart);
 
+        Shader &sunShader = depthTarget->isLogarithmic() ? sunShaderLog : sunShaderPlain;
+        Shader &planetShader = depthTarget->isLogarithmic() ? planetShaderLog : planetShaderPlain;
+
+        gpuProfiler->beginPass("sun");
         sunShader.use();
         sunShader.setMat4("projection", projection);
         sunShader.setMat4("view", view);
+        modernSphere.setUniforms(sunShader);
+        depthTarget->setUniforms(sunShader);
 
-        sun->update(deltaTime);
         sun->render(sunShader, modernSphere, view, projection);
+        gpuProfiler->endPass();
 
+        gpuProfiler->beginPass("planets");
         planetShader.use();
         planetShader.setMat4("projection", projection);
         planetShader.setMat4("view", view);
+        modernSphere.setUniforms(planetShader);
+        depthTarget->setUniforms(planetShader);
 
         planetShader.setVec3("lightDir", glm::vec3(0.0f, -1.0f, 0.0f));
         planetShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 0.8f));
@@ -147,30 +297,172 @@ int main()
         planetShader.setVec3("pointLightColor", glm::vec3(0.0f, 0.0f, 1.0f));
 
         planetShader.setVec3("viewPos", camera.Position);
+        virtualTextures->setUniforms(planetShader);
 
         for (auto planet : planets)
+            planet->render(planetShader, modernSphere, view, projection, &frustum);
+        gpuProfiler->endPass();
+
+        depthTarget->end();
+
+        if (!virtualTextures->isEmpty())
         {
-            planet->update(deltaTime);
-            planet->render(planetShader, modernSphere, view, projection);
+            gpuProfiler->beginPass("vt feedback");
+            Shader &feedbackShader = virtualTextures->beginFeedback(depthTarget->isLogarithmic());
+            feedbackShader.setMat4("projection", projection);
+            feedbackShader.setMat4("view", view);
+            modernSphere.setUniforms(feedbackShader);
+            depthTarget->setUniforms(feedbackShader);
+            for (auto planet : planets)
+                planet->renderFeedback(feedbackShader, modernSphere, frustum);
+            virtualTextures->endFeedback();
+            gpuProfiler->endPass();
         }
+        gpuProfiler->endFrame();
 
+        double presentStart = timer.getElapsedTimeInMilliSec();
+        double cpuMs = presentStart - currentFrame * 1000.0;
+        frameStats.record(FRAME_CPU, cpuMs);
         glfwSwapBuffers(window);
+        double presentMs = timer.getElapsedTimeInMilliSec() - presentStart;
+        frameStats.record(FRAME_PRESENT, presentMs);
+        if (benchmark)
+            benchmark->recordSample(frameMs, cpuMs, presentMs);
+
+        // GPU times arrive a few frames late, record each one once
+        if (gpuProfiler->getFrameSamples() != gpuFrameSamples)
+        {
+            gpuFrameSamples = gpuProfiler->getFrameSamples();
+            frameStats.record(FRAME_GPU, gpuProfiler->getFrameMs());
+        }
+
+        publish_telemetry(telemetry, *gpuProfiler, modernSphere, currentFrame, frameMs, cpuMs, presentMs);
+
+        // the window title is the stats overlay
+        if (currentFrame - lastOverlayUpdate > 0.5)
+        {
+            char title[256] = "Solar System | ";
+            size_t prefix = strlen(title);
+            frameStats.getSummary(title + prefix, sizeof(title) - prefix);
+            glfwSetWindowTitle(window, title);
+            lastOverlayUpdate = currentFrame;
+        }
+
+        if (statsDumpRequested)
+        {
+            statsDumpRequested = 0;
+            dump_frame_stats();
+        }
+
         glfwPollEvents();
+
+        if (benchmark)
+        {
+            bool warmingUp = benchmark->isWarmingUp();
+            benchmark->endFrame(modernSphere.getDrawCalls(), modernSphere.getTrianglesDrawn());
+            if (warmingUp && !benchmark->isWarmingUp())
+            {
+                frameStats.reset();
+                MemoryStats::resetFrames();
+            }
+        }
+        modernSphere.resetCounters();
+        MemoryStats::endFrame();
+        GlStats::endFrame();
+        StallDetector::endFrame();
+        PROBE4(frame_end, frameIndex, (long long)(frameMs * 1e6), (long long)(cpuMs * 1e6), (long long)(presentMs * 1e6));
+        frameIndex++;
+    }
+
+    if (benchmark)
+    {
+        benchmark->writeReport(frameStats);
+        benchmark->writeSamples();
+        delete benchmark;
     }
 
+    gpuProfiler->printStats();
+    MemoryStats::printReport();
+    GlStats::printReport();
+    StallDetector::printReport();
+    dump_frame_stats();
+
     delete sun;
     for (auto planet : planets)
     {
         delete planet;
     }
+    delete sceneGenerator;
+    delete virtualTextures;
+    delete textureManager;
+    delete sphere;
+    delete depthTarget;
+    delete gpuProfiler;
+    AssetPack::unmount();
 
     glfwTerminate();
     return 0;
 }
 
+// The sun's nine planets and the moon
+void create_solar_system()
+{
+    // Mercury
+    Planet *mercury = new Planet(15.0f, 47.0f, 20.0f, 0.8f, textureManager->load("textures/mercurymap.jpg"));
+    planets.push_back(mercury);
+
+    // Venus
+    Planet *venus = new Planet(22.0f, 35.0f, 15.0f, 1.5f, textureManager->load("textures/venusmap.jpg"));
+    planets.push_back(venus);
+
+    // Earth with Moon
+    Planet *earth = new Planet(30.0f, 30.0f, 25.0f, 1.6f, textureManager->load("textures/earthmap1k.jpg"));
+    Planet *moon = new Planet(3.0f, 80.0f, 15.0f, 0.4f, textureManager->load("textures/moonmap1k.jpg"));
+    earth->addMoon(moon);
+    planets.push_back(earth);
+
+    // Mars
+    Planet *mars = new Planet(40.0f, 24.0f, 20.0f, 1.2f, textureManager->load("textures/marsmap1k.jpg"));
+    planets.push_back(mars);
+
+    // Jupiter
+    Planet *jupiter = new Planet(55.0f, 13.0f, 12.0f, 4.0f, textureManager->load("textures/jupitermap.jpg"));
+    planets.push_back(jupiter);
+
+    // Saturn
+    Planet *saturn = new Planet(70.0f, 9.0f, 10.0f, 3.5f, textureManager->load("textures/saturnmap.png"));
+    planets.push_back(saturn);
+
+    // Uranus
+    Planet *uranus = new Planet(85.0f, 6.0f, 8.0f, 2.5f, textureManager->load("textures/uranusmap.png"));
+    planets.push_back(uranus);
+
+    // Neptune
+    Planet *neptune = new Planet(100.0f, 5.0f, 7.0f, 2.4f, textureManager->load("textures/neptunemap.jpg"));
+    planets.push_back(neptune);
+
+    // Pluto
+    Planet *pluto = new Planet(115.0f, 4.0f, 5.0f, 0.6f, textureManager->load("textures/plutomap.png"));
+    planets.push_back(pluto);
+}
+
+void open_virtual_textures(Planet *planet)
+{
+    if (planet->texture)
+    {
+        std::string path = planet->texture->getPath();
+        planet->virtualTexture = virtualTextures->open((path.substr(0, path.find_last_of('.')) + ".vtex").c_str());
+    }
+
+    for (auto moon : planet->moons)
+        open_virtual_textures(moon);
+}
+
 // Process all input
 void processInput(GLFWwindow *window)
 {
+    PROFILE_SCOPE("processInput");
+
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
@@ -183,12 +475,24 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
+    // cycle depth modes, once per key press
+    bool depthKey = glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS;
+    if (depthKey && !depthKeyPressed)
+        depthTarget->nextMode();
+    depthKeyPressed = depthKey;
+
+    // dump the CPU profiler timeline
+    bool traceKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if (traceKey && !traceKeyPressed)
+        Profiler::writeChromeTrace("solar-system-trace.json");
+    traceKeyPressed = traceKey;
+
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
         sun->adjustRotationSpeed(0.4f);
     if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
         sun->adjustRotationSpeed(-0.4f);
 
-    Planet *earth = planets[2];
+    Planet *earth = planets.size() > 2 ? planets[2] : NULL;
     if (earth && !earth->moons.empty())
     {
         Planet *moon = earth->moons[0];
@@ -199,9 +503,65 @@ void processInput(GLFWwindow *window)
     }
 }
 
+// SIGUSR1: dump the frame stats from the main loop
+void request_stats_dump(int)
+{
+    statsDumpRequested = 1;
+}
+
+void dump_frame_stats()
+{
+    frameStats.writeCsv("frame-stats.csv");
+    frameStats.writeJson("frame-stats.json");
+}
+
+void publish_telemetry(Telemetry &telemetry, const GpuProfiler &gpuProfiler, const ModernSphere &sphere, double time,
+                       double frameMs, double cpuMs, double presentMs)
+{
+    if (!telemetry.isOpen())
+        return;
+
+    TelemetryFrame frame;
+    frame.time = time;
+    frame.frameMs = (float)frameMs;
+    frame.cpuMs = (float)cpuMs;
+    frame.gpuMs = gpuProfiler.getFrameMs();
+    frame.presentMs = (float)presentMs;
+
+    frame.bodies = bodyCount;
+    frame.drawCalls = sphere.getDrawCalls();
+    frame.triangles = (uint32_t)sphere.getTrianglesDrawn();
+
+    frame.cpuBytes = 0;
+    frame.gpuBytes = 0;
+    for (int tag = 0; tag < MEM_TAG_COUNT; ++tag)
+    {
+        frame.cpuBytes += MemoryStats::getCpuBytes((MemoryTag)tag);
+        frame.gpuBytes += MemoryStats::getGpuBytes((MemoryTag)tag);
+    }
+    frame.allocations = MemoryStats::getAllocationCount();
+
+    frame.passCount = 0;
+    for (int i = 0; i < gpuProfiler.getPassCount() && i < TelemetryFrame::MAX_PASSES; ++i)
+    {
+        const GpuProfiler::PassStats &pass = gpuProfiler.getPass(i);
+        strncpy(frame.passNames[i], pass.name, TelemetryFrame::NAME_SIZE);
+        frame.passMs[i] = pass.lastMs;
+        frame.passCount++;
+    }
+
+    telemetry.publish(frame);
+}
+
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    if (depthTarget)
+        depthTarget->resize(width, height);
+    if (textureManager)
+        textureManager->setViewportHeight(height);
+    if (virtualTextures)
+        virtualTextures->resize(width, height);
 }
 
 void mouse_callback(GLFWwindow *window, double xposIn, double yposIn)
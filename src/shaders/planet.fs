@@ -6,12 +6,44 @@ in vec3 Normal;
 in vec3 FragPos;
 
 uniform sampler2D texture1;
+
+// virtual texture: an indirection texel per tile, pointing into the tile cache
+uniform bool virtualTexture;
+uniform sampler2D pageTable;
+uniform sampler2D tileCache;
+uniform vec2 vtSize; // level 0, in texels
+uniform int vtLevels;
+uniform float vtTileSize;
+uniform float vtBorder;
+uniform float vtCacheSize; // texels across the tile cache
+
+// logarithmic depth fallback, only in the LOG_DEPTH variant: writing gl_FragDepth at all disables early-Z
+#ifdef LOG_DEPTH
+in float flogz;
+uniform float logDepthCoef;
+#endif
 uniform vec3 lightDir;
 uniform vec3 lightColor;
 uniform vec3 pointLightPos;
 uniform vec3 pointLightColor;
 uniform vec3 viewPos;
 
+vec4 sampleVirtual(vec2 uv) {
+    vec2 pos = min(clamp(uv, 0.0, 1.0) * vtSize, vtSize - 0.5);
+    float lod = log2(max(length(dFdx(pos)), length(dFdy(pos))));
+    int level = clamp(int(floor(lod)), 0, vtLevels - 1);
+
+    // the finest resident tile covering this one: its cache slot and its level
+    ivec2 tiles = textureSize(pageTable, level);
+    ivec2 tile = min(ivec2(pos / exp2(float(level)) / vtTileSize), tiles - 1);
+    vec3 entry = floor(texelFetch(pageTable, tile, level).rgb * 255.0 + 0.5);
+
+    vec2 residentPos = pos / exp2(entry.b);
+    vec2 inTile = residentPos - floor(residentPos / vtTileSize) * vtTileSize;
+    vec2 texel = entry.rg * (vtTileSize + 2.0 * vtBorder) + vtBorder + inTile;
+    return texture(tileCache, texel / vtCacheSize);
+}
+
 void main() {
     // Ambient
     float ambientStrength = 0.1;
@@ -42,7 +74,12 @@ void main() {
     
     // Combine results
     vec3 result = (ambient + diffuse + pointDiffuse + specular);
-    vec4 texColor = texture(texture1, TexCoords);
+    vec4 texColor = virtualTexture ? sampleVirtual(TexCoords) : texture(texture1, TexCoords);
     
     FragColor = vec4(result, 1.0) * texColor;
+
+#ifdef LOG_DEPTH
+    // per-fragment so the depth stays logarithmic across large triangles
+    gl_FragDepth = log2(flogz) * logDepthCoef * 0.5;
+#endif
 }
\ No newline at end of file
@@ -11,10 +11,54 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// logarithmic depth fallback, compiled in with LOG_DEPTH
+#ifdef LOG_DEPTH
+uniform float logDepthCoef; // 2 / log2(far + 1)
+out float flogz;
+#endif
+
+// procedural sphere (no vertex buffers bound)
+uniform bool procedural;
+uniform int sectorCount;
+uniform int stackCount;
+
+const float PI = 3.14159265359;
+
+// rebuild vertex gl_VertexID of the unit sphere, same layout as Sphere::buildVerticesSmooth()
+void sphereVertex(out vec3 pos, out vec2 uv) {
+    int quad = gl_VertexID / 6;
+    int corner = gl_VertexID % 6;
+
+    // k1, k2, k1+1 and k1+1, k2, k2+1
+    int di = (corner == 1 || corner == 4 || corner == 5) ? 1 : 0;
+    int dj = (corner == 2 || corner == 3 || corner == 5) ? 1 : 0;
+
+    int i = quad / sectorCount + di;
+    int j = quad % sectorCount + dj;
+
+    float stackAngle = PI / 2.0 - float(i) * PI / float(stackCount);
+    float sectorAngle = float(j) * 2.0 * PI / float(sectorCount);
+
+    pos = vec3(cos(stackAngle) * cos(sectorAngle), cos(stackAngle) * sin(sectorAngle), sin(stackAngle));
+    uv = vec2(float(j) / float(sectorCount), float(i) / float(stackCount));
+}
+
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 pos = aPos;
+    vec3 normal = aNormal;
     TexCoords = aTexCoords;
+    if (procedural) {
+        sphereVertex(pos, TexCoords);
+        normal = pos;
+    }
+
+    FragPos = vec3(model * vec4(pos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+
+#ifdef LOG_DEPTH
+    flogz = 1.0 + gl_Position.w;
+    gl_Position.z = (log2(max(1e-6, flogz)) * logDepthCoef - 1.0) * gl_Position.w;
+#endif
+}
@@ -5,7 +5,18 @@ in vec2 TexCoords;
 
 uniform sampler2D texture1;
 
+// logarithmic depth fallback, compiled in with LOG_DEPTH
+#ifdef LOG_DEPTH
+in float flogz;
+uniform float logDepthCoef;
+#endif
+
 void main() {
     vec4 texColor = texture(texture1, TexCoords);
-    FragColor = texColor * 1.2; 
+    FragColor = texColor * 1.2;
+
+#ifdef LOG_DEPTH
+    // per-fragment so the depth stays logarithmic across large triangles
+    gl_FragDepth = log2(flogz) * logDepthCoef * 0.5;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 330 core
+// virtual texture feedback: which tile, at which level, each pixel needs
+layout (location = 0) out uvec4 feedback;
+
+in vec2 TexCoords;
+
+uniform vec2 vtSize; // level 0, in texels
+uniform int vtLevels;
+uniform int vtId;
+uniform float vtTileSize;
+uniform float lodBias; // this target is smaller than the screen
+
+// logarithmic depth fallback, compiled in with LOG_DEPTH
+#ifdef LOG_DEPTH
+in float flogz;
+uniform float logDepthCoef;
+#endif
+
+void main() {
+    // same level selection as sampleVirtual() in planet.fs
+    vec2 pos = min(clamp(TexCoords, 0.0, 1.0) * vtSize, vtSize - 0.5);
+    float lod = log2(max(length(dFdx(pos)), length(dFdy(pos)))) + lodBias;
+    int level = clamp(int(floor(lod)), 0, vtLevels - 1);
+
+    uvec2 tile = uvec2(pos / exp2(float(level)) / vtTileSize);
+    feedback = uvec4(tile, uint(level), uint(vtId));
+
+#ifdef LOG_DEPTH
+    gl_FragDepth = log2(flogz) * logDepthCoef * 0.5;
+#endif
+}
@@ -1,2 +1,26 @@
+#include "MemoryStats.h"
+#include <cstdlib>
+
+// decode buffers count as heap allocations, like operator new
+static void *stbiMalloc(size_t size)
+{
+    MemoryStats::countAllocation(size);
+    return malloc(size);
+}
+
+static void *stbiRealloc(void *ptr, size_t size)
+{
+    MemoryStats::countAllocation(size);
+    return realloc(ptr, size);
+}
+
+static void stbiFree(void *ptr)
+{
+    free(ptr);
+}
+
+#define STBI_MALLOC(size) stbiMalloc(size)
+#define STBI_REALLOC(ptr, size) stbiRealloc(ptr, size)
+#define STBI_FREE(ptr) stbiFree(ptr)
 #define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
\ No newline at end of file
+#include <stb_image.h>
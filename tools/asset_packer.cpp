@@ -0,0 +1,148 @@
+// Packs the app's assets into one file that AssetPack maps at startup, so the
+// loaders read from the mapping instead of opening and copying loose files.
+// Run from src/, so the names match the paths the app loads:
+//   ../build/asset_packer [-o assets.pak] textures/* shaders/*
+//   ../build/asset_packer --list assets.pak   (prints the index, checks the hashes)
+// The format of each asset comes from its extension. Page files (.vtex) are
+// skipped: the virtual texture cache reads them with pread.
+
+#include "AssetPack.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static bool readFile(const char *path, std::vector<unsigned char> &data)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? size : 0);
+    bool ok = size >= 0 && fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return ok;
+}
+
+static size_t align(size_t value)
+{
+    return (value + AssetPack::ALIGNMENT - 1) / AssetPack::ALIGNMENT * AssetPack::ALIGNMENT;
+}
+
+static int pack(const char *outPath, const std::vector<std::string> &names)
+{
+    std::vector<AssetPackEntry> entries(names.size());
+    std::string allNames;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        entries[i].nameOffset = (unsigned int)allNames.size();
+        entries[i].nameLength = (unsigned int)names[i].size();
+        entries[i].format = AssetPack::getFormat(names[i]);
+        entries[i].reserved = 0;
+        allNames += names[i];
+    }
+
+    AssetPackHeader header;
+    memcpy(header.magic, "SAPK", 4);
+    header.version = AssetPack::VERSION;
+    header.entryCount = (unsigned int)entries.size();
+    header.namesSize = (unsigned int)allNames.size();
+
+    FILE *out = fopen(outPath, "wb");
+    if (!out)
+    {
+        printf("Failed to create %s\n", outPath);
+        return 1;
+    }
+
+    // the data first, the index is written over the front once the offsets are known
+    size_t offset = align(sizeof(header) + entries.size() * sizeof(AssetPackEntry) + allNames.size());
+    size_t total = 0;
+    std::vector<unsigned char> data;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        if (!readFile(names[i].c_str(), data))
+        {
+            printf("Failed to read %s\n", names[i].c_str());
+            fclose(out);
+            return 1;
+        }
+        entries[i].offset = offset;
+        entries[i].size = data.size();
+        entries[i].hash = AssetPack::hash(data.data(), data.size());
+        fseek(out, (long)offset, SEEK_SET);
+        fwrite(data.data(), 1, data.size(), out);
+        offset = align(offset + data.size());
+        total += data.size();
+    }
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(entries.data(), sizeof(AssetPackEntry), entries.size(), out);
+    fwrite(allNames.data(), 1, allNames.size(), out);
+    bool ok = fflush(out) == 0 && !ferror(out);
+    fclose(out);
+    if (!ok)
+    {
+        printf("Failed to write %s\n", outPath);
+        return 1;
+    }
+
+    printf("%s: %zu assets, %zu KB\n", outPath, names.size(), total / 1024);
+    return 0;
+}
+
+static int list(const char *path)
+{
+    std::vector<unsigned char> pack;
+    AssetPackHeader header;
+    if (!readFile(path, pack) || pack.size() < sizeof(header))
+    {
+        printf("Failed to read %s\n", path);
+        return 1;
+    }
+    memcpy(&header, pack.data(), sizeof(header));
+    size_t namesStart = sizeof(header) + (size_t)header.entryCount * sizeof(AssetPackEntry);
+    if (memcmp(header.magic, "SAPK", 4) != 0 || namesStart + header.namesSize > pack.size())
+    {
+        printf("Not an asset pack: %s\n", path);
+        return 1;
+    }
+
+    int bad = 0;
+    for (unsigned int i = 0; i < header.entryCount; ++i)
+    {
+        AssetPackEntry entry;
+        memcpy(&entry, &pack[sizeof(header) + i * sizeof(AssetPackEntry)], sizeof(entry));
+        std::string name((const char *)&pack[namesStart + entry.nameOffset], entry.nameLength);
+        bool ok = entry.offset + entry.size <= pack.size() && AssetPack::hash(&pack[entry.offset], entry.size) == entry.hash;
+        printf("%10llu  %-6s  %016llx  %s%s\n", entry.size, AssetPack::getFormatName(entry.format), entry.hash, name.c_str(),
+               ok ? "" : "  BAD HASH");
+        bad += !ok;
+    }
+    return bad ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *outPath = "assets.pak";
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--list") == 0 && i + 1 < argc)
+            return list(argv[i + 1]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if (strstr(argv[i], ".vtex") == NULL)
+            names.push_back(argv[i]);
+    }
+
+    if (names.empty())
+    {
+        printf("Usage: asset_packer [-o assets.pak] file...\n       asset_packer --list assets.pak\n");
+        return 2;
+    }
+    return pack(outPath, names);
+}
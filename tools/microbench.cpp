@@ -0,0 +1,268 @@
+// Microbenchmarks for the core kernels.
+// Run from src/ so the shader and texture paths resolve:
+//   ../build/microbench [name filter] [--csv file]
+// Each benchmark reports ns/op, ops/s and heap allocations per op, counted by
+// the MemoryStats hook: operator new, and stb_image's decode buffers.
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "Sphere.h"
+#include "Planet.h"
+#include "TextureManager.h"
+#include "Camera.h"
+#include "Shader.h"
+#include "Timer.h"
+#include "MemoryStats.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// keep the compiler from removing a result
+template <typename T>
+static inline void keep(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result
+{
+    std::string name;
+    double nsPerOp;
+    double opsPerSec;
+    double allocsPerOp;
+};
+
+static const char *filter = NULL;
+static std::vector<Result> results;
+
+// runs fn (which performs opsPerCall operations) until it has taken minSec, 5 times, keeps the fastest round
+template <typename F>
+static void bench(const std::string &name, int opsPerCall, F fn, double minSec = 0.2)
+{
+    if (filter && name.find(filter) == std::string::npos)
+        return;
+
+    fn(); // warm caches, lazy init
+
+    double bestNs = 0.0;
+    double allocs = 0.0;
+    for (int round = 0; round < 5; ++round)
+    {
+        unsigned long long calls = 0;
+        unsigned long long allocStart = MemoryStats::getAllocationCount();
+        Timer timer;
+        timer.start();
+        do
+        {
+            fn();
+            calls++;
+        } while (timer.getElapsedTimeInSec() < minSec);
+        double ns = timer.getElapsedTimeInMicroSec() * 1000.0 / ((double)calls * opsPerCall);
+
+        if (round == 0 || ns < bestNs)
+            bestNs = ns;
+        allocs = (double)(MemoryStats::getAllocationCount() - allocStart) / ((double)calls * opsPerCall);
+    }
+
+    Result result = {name, bestNs, 1.0e9 / bestNs, allocs};
+    results.push_back(result);
+    printf("%-36s %14.1f ns/op %14.0f ops/s %10.2f allocs/op\n", name.c_str(), result.nsPerOp, result.opsPerSec, result.allocsPerOp);
+    fflush(stdout);
+}
+
+// bench() for operations that need undoing between calls: reset runs after every
+// call of fn, outside the time and the allocation count
+template <typename F, typename R>
+static void bench(const std::string &name, int opsPerCall, F fn, R reset, double minSec)
+{
+    if (filter && name.find(filter) == std::string::npos)
+        return;
+
+    fn();
+    reset();
+
+    double bestNs = 0.0;
+    double allocs = 0.0;
+    double minTicks = minSec * Timer::getTicksPerSec();
+    for (int round = 0; round < 5; ++round)
+    {
+        unsigned long long calls = 0;
+        unsigned long long fnAllocations = 0;
+        long long ticks = 0;
+        do
+        {
+            unsigned long long allocStart = MemoryStats::getAllocationCount();
+            long long start = Timer::getTicks();
+            fn();
+            ticks += Timer::getTicks() - start;
+            fnAllocations += MemoryStats::getAllocationCount() - allocStart;
+            calls++;
+            reset();
+        } while (ticks < minTicks);
+        double ns = ticks / Timer::getTicksPerSec() * 1.0e9 / ((double)calls * opsPerCall);
+
+        if (round == 0 || ns < bestNs)
+            bestNs = ns;
+        allocs = (double)fnAllocations / ((double)calls * opsPerCall);
+    }
+
+    Result result = {name, bestNs, 1.0e9 / bestNs, allocs};
+    results.push_back(result);
+    printf("%-36s %14.1f ns/op %14.0f ops/s %10.2f allocs/op\n", name.c_str(), result.nsPerOp, result.opsPerSec, result.allocsPerOp);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    const char *csvPath = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+            csvPath = argv[++i];
+        else
+            filter = argv[i];
+    }
+
+    // hidden window, the texture and uniform benchmarks need a context
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "microbench", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        printf("Failed to initialize GLAD\n");
+        return -1;
+    }
+
+    // Sphere construction
+    int tessellations[][2] = {{18, 9}, {36, 18}, {72, 36}, {144, 72}};
+    for (auto &t : tessellations)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "Sphere(%d x %d)", t[0], t[1]);
+        bench(name, 1, [&]() {
+            Sphere sphere(1.0f, t[0], t[1], true);
+            keep(sphere.getInterleavedVertices());
+        });
+    }
+
+    // Planet::update over N bodies with one moon each
+    int bodyCounts[] = {10, 1000, 100000};
+    for (int count : bodyCounts)
+    {
+        std::vector<Planet *> bodies;
+        for (int i = 0; i < count; ++i)
+        {
+            Planet *body = new Planet(15.0f + i * 0.01f, 10.0f + i % 40, 20.0f, 1.0f, NULL);
+            body->addMoon(new Planet(3.0f, 80.0f, 15.0f, 0.4f, NULL));
+            bodies.push_back(body);
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "Planet::update(%d bodies)", count);
+        bench(name, count, [&]() {
+            for (Planet *body : bodies)
+                body->update(0.016f);
+            keep(bodies[0]->position);
+        });
+
+        for (Planet *body : bodies)
+            delete body;
+    }
+
+    {
+        Planet body(30.0f, 30.0f, 25.0f, 1.6f, NULL);
+        body.update(0.5f);
+        bench("Planet::getModelMatrix", 1, [&]() {
+            glm::mat4 model = body.getModelMatrix();
+            keep(model);
+        });
+    }
+
+    {
+        Camera camera(glm::vec3(0.0f, 0.0f, 160.0f));
+        bench("Camera::GetViewMatrix", 1, [&]() {
+            glm::mat4 view = camera.GetViewMatrix();
+            keep(view);
+        });
+    }
+
+    // texture decode and upload, one map and then all of them: serial and on the thread pool.
+    // load() only registers a path, loadAll() starts the loads finish() waits for. The
+    // managers and their threads outlive the rounds, unloadAll() undoes each load untimed
+    const char *textures[] = {"textures/earthmap1k.jpg", "textures/saturnmap.png"};
+    for (const char *path : textures)
+    {
+        std::string name = std::string("TextureManager::load(") + path + ")";
+        TextureManager manager(1);
+        bench(name, 1, [&]() {
+            Texture *texture = manager.load(path);
+            manager.loadAll();
+            manager.finish();
+            keep(texture->getId());
+        }, [&]() { manager.unloadAll(); }, 1.0);
+    }
+
+    const char *allTextures[] = {"textures/sunmap.jpg", "textures/mercurymap.jpg", "textures/venusmap.jpg", "textures/earthmap1k.jpg",
+                                 "textures/moonmap1k.jpg", "textures/marsmap1k.jpg", "textures/jupitermap.jpg", "textures/saturnmap.png",
+                                 "textures/uranusmap.png", "textures/neptunemap.jpg", "textures/plutomap.png"};
+    int threadCounts[] = {1, 0};
+    for (int threads : threadCounts)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "TextureManager all maps (%s)", threads == 1 ? "1 thread" : "pool");
+        TextureManager manager(threads);
+        bench(name, 1, [&]() {
+            for (const char *path : allTextures)
+                manager.load(path);
+            manager.loadAll();
+            manager.finish();
+        }, [&]() { manager.unloadAll(); }, 2.0);
+    }
+
+    {
+        Shader shader("shaders/planet.vs", "shaders/planet.fs");
+        shader.use();
+        glm::mat4 model(1.0f);
+        glm::vec3 color(1.0f, 1.0f, 0.8f);
+        bench("Shader::setMat4", 1, [&]() {
+            shader.setMat4("model", model);
+        });
+        bench("Shader::setVec3", 1, [&]() {
+            shader.setVec3("pointLightColor", color);
+        });
+        glDeleteProgram(shader.ID);
+    }
+
+    if (csvPath)
+    {
+        FILE *file = fopen(csvPath, "w");
+        if (file)
+        {
+            fprintf(file, "name,ns_per_op,ops_per_sec,allocs_per_op\n");
+            for (const Result &result : results)
+                fprintf(file, "\"%s\",%.3f,%.1f,%.3f\n", result.name.c_str(), result.nsPerOp, result.opsPerSec, result.allocsPerOp);
+            fclose(file);
+        }
+        else
+        {
+            printf("Failed to write %s\n", csvPath);
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
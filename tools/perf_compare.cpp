@@ -0,0 +1,258 @@
+// Compares two sets of benchmark runs (solar-system --benchmark ... --samples file)
+// metric by metric with a two-sided Mann-Whitney U test.
+//
+//   perf_compare [--alpha 0.01] [--threshold 2] base.csv [base2.csv ...] -- candidate.csv [...]
+//
+// Each file is one run and the run is the unit: it is reduced to the median of
+// every metric, and the medians of the runs are compared. Frames of one run are
+// not independent, and runs vary more than frames, so testing pooled frames
+// finds significant differences in harmless run-to-run drift.
+//
+// A metric regresses when the median of its run medians rises by more than
+// threshold percent and the difference is significant at alpha. With few runs
+// the exact distribution of U is used; 5 runs a side can reach alpha 0.01. The
+// exit code is 1 when any metric regressed, so CI can fail on it.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Samples
+{
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns; // one median per run
+};
+
+static double median(std::vector<double> values);
+
+static bool readCsv(const char *path, Samples &samples)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "Failed to read samples: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(file, line))
+        return false;
+
+    std::vector<std::string> names;
+    std::istringstream header(line);
+    std::string name;
+    while (std::getline(header, name, ','))
+        names.push_back(name);
+
+    if (samples.names.empty())
+    {
+        samples.names = names;
+        samples.columns.resize(names.size());
+    }
+    else if (names != samples.names)
+    {
+        std::cout << "Columns of " << path << " do not match the other files" << std::endl;
+        return false;
+    }
+
+    std::vector<std::vector<double>> frames(names.size());
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string field;
+        for (size_t i = 0; i < names.size() && std::getline(fields, field, ','); ++i)
+            frames[i].push_back(atof(field.c_str()));
+    }
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        if (frames[i].empty())
+        {
+            std::cout << "No samples of " << names[i] << " in " << path << std::endl;
+            return false;
+        }
+        samples.columns[i].push_back(median(frames[i]));
+    }
+    return true;
+}
+
+static double median(std::vector<double> values)
+{
+    if (values.empty())
+        return 0.0;
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    double upper = values[middle];
+    if (values.size() % 2)
+        return upper;
+    return 0.5 * (upper + *std::max_element(values.begin(), values.begin() + middle));
+}
+
+// P(U <= u) for samples of n1 and n2 values without ties, by counting the
+// orderings: the largest value is either from the first sample (adding n2 to U)
+// or from the second.
+static double exactCdf(size_t n1, size_t n2, double u)
+{
+    size_t maxU = n1 * n2;
+    // counts[j][v]: orderings of i and j values with U == v, built up over i
+    std::vector<std::vector<double>> counts(n2 + 1, std::vector<double>(maxU + 1, 0.0));
+    for (size_t j = 0; j <= n2; ++j)
+        counts[j][0] = 1.0;
+    for (size_t i = 1; i <= n1; ++i)
+    {
+        std::vector<std::vector<double>> next(n2 + 1, std::vector<double>(maxU + 1, 0.0));
+        next[0][0] = 1.0;
+        for (size_t j = 1; j <= n2; ++j)
+        {
+            for (size_t v = 0; v <= maxU; ++v)
+                next[j][v] = (v >= j ? counts[j][v - j] : 0.0) + next[j - 1][v];
+        }
+        counts.swap(next);
+    }
+
+    double below = 0.0, total = 0.0;
+    for (size_t v = 0; v <= maxU; ++v)
+    {
+        total += counts[n2][v];
+        if (v <= u)
+            below += counts[n2][v];
+    }
+    return below / total;
+}
+
+// two-sided p-value of the Mann-Whitney U test: exact for small samples without
+// ties, otherwise the normal approximation with tie correction.
+// probability is P(candidate > base), 0.5 when both are alike.
+static double mannWhitney(const std::vector<double> &base, const std::vector<double> &candidate, double &probability)
+{
+    size_t n1 = base.size(), n2 = candidate.size(), n = n1 + n2;
+
+    std::vector<std::pair<double, int>> all;
+    all.reserve(n);
+    for (double value : base)
+        all.push_back(std::make_pair(value, 0));
+    for (double value : candidate)
+        all.push_back(std::make_pair(value, 1));
+    std::sort(all.begin(), all.end());
+
+    // average ranks over ties
+    double rankSumCandidate = 0.0, tieTerm = 0.0;
+    for (size_t i = 0; i < n;)
+    {
+        size_t j = i;
+        while (j < n && all[j].first == all[i].first)
+            j++;
+        double rank = 0.5 * (i + 1 + j); // ranks i+1..j
+        for (size_t k = i; k < j; ++k)
+        {
+            if (all[k].second)
+                rankSumCandidate += rank;
+        }
+        double t = (double)(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+
+    double u = rankSumCandidate - n2 * (n2 + 1) / 2.0;
+    double mean = n1 * (double)n2 / 2.0;
+    double variance = n1 * (double)n2 / 12.0 * ((n + 1) - tieTerm / ((double)n * (n - 1)));
+    probability = u / (n1 * (double)n2);
+    if (tieTerm == 0.0 && n <= 40)
+    {
+        // U of the base sample is n1 * n2 - u, so P(U >= u) is P(U_base <= n1 * n2 - u)
+        double p = 2.0 * std::min(exactCdf(n2, n1, u), exactCdf(n1, n2, n1 * (double)n2 - u));
+        return std::min(p, 1.0);
+    }
+    if (variance <= 0.0)
+        return 1.0;
+
+    double diff = u - mean;
+    double z = (fabs(diff) - 0.5) / sqrt(variance); // continuity correction
+    if (z < 0.0)
+        z = 0.0;
+    return erfc(z / sqrt(2.0));
+}
+
+int main(int argc, char **argv)
+{
+    double alpha = 0.01;
+    double threshold = 2.0; // percent
+    std::vector<const char *> basePaths, candidatePaths;
+    bool candidates = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc)
+            alpha = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--") == 0)
+            candidates = true;
+        else
+            (candidates ? candidatePaths : basePaths).push_back(argv[i]);
+    }
+
+    if (basePaths.empty() || candidatePaths.empty())
+    {
+        std::cout << "Usage: perf_compare [--alpha 0.01] [--threshold 2] base.csv [...] -- candidate.csv [...]" << std::endl;
+        return 2;
+    }
+
+    Samples base, candidate;
+    for (const char *path : basePaths)
+        if (!readCsv(path, base))
+            return 2;
+    for (const char *path : candidatePaths)
+        if (!readCsv(path, candidate))
+            return 2;
+    if (base.names != candidate.names)
+    {
+        std::cout << "Baseline and candidate have different columns" << std::endl;
+        return 2;
+    }
+
+    size_t baseRuns = basePaths.size(), candidateRuns = candidatePaths.size();
+    if (baseRuns + candidateRuns <= 40 && 2.0 * exactCdf(baseRuns, candidateRuns, 0.0) >= alpha)
+        std::cout << baseRuns << " and " << candidateRuns << " runs can't reach alpha " << alpha << ", record more" << std::endl;
+
+    printf("%-12s %8s %8s %10s %10s %8s %10s %7s  %s\n", "metric", "runs b", "runs c", "base p50", "cand p50", "change",
+           "p-value", "P(c>b)", "verdict");
+
+    bool regressed = false;
+    for (size_t i = 0; i < base.names.size(); ++i)
+    {
+        const std::vector<double> &a = base.columns[i];
+        const std::vector<double> &b = candidate.columns[i];
+        if (a.size() < 2 || b.size() < 2)
+            continue;
+
+        double baseMedian = median(a);
+        double candidateMedian = median(b);
+        double change = baseMedian > 0.0 ? (candidateMedian - baseMedian) / baseMedian * 100.0 : 0.0;
+        double probability;
+        double p = mannWhitney(a, b, probability);
+
+        const char *verdict = "same";
+        if (p < alpha && change > threshold)
+        {
+            verdict = "REGRESSION";
+            regressed = true;
+        }
+        else if (p < alpha && change < -threshold)
+            verdict = "improvement";
+        else if (p < alpha)
+            verdict = "shift below threshold";
+
+        printf("%-12s %8zu %8zu %10.3f %10.3f %+7.2f%% %10.2g %7.3f  %s\n", base.names[i].c_str(), a.size(), b.size(),
+               baseMedian, candidateMedian, change, p, probability, verdict);
+    }
+
+    return regressed ? 1 : 0;
+}
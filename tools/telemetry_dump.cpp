@@ -0,0 +1,114 @@
+// Reads the live telemetry of a running solar-system (see src/Telemetry.h).
+//
+//   telemetry_dump [pid] [--csv] [--interval ms]
+//
+// Without a pid it attaches to the first /dev/shm/solar-system-* it finds.
+// Prints every frame published since the last poll; frames the app published
+// faster than the poll interval allows to read are counted as skipped.
+
+#include "Telemetry.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+
+static int findApp()
+{
+    DIR *dir = opendir("/dev/shm");
+    if (!dir)
+        return 0;
+    int pid = 0;
+    while (dirent *entry = readdir(dir))
+    {
+        int candidate;
+        if (sscanf(entry->d_name, "solar-system-%d", &candidate) == 1 && kill(candidate, 0) == 0)
+        {
+            pid = candidate;
+            break;
+        }
+    }
+    closedir(dir);
+    return pid;
+}
+
+static void printFrame(const TelemetryFrame &frame, bool csv)
+{
+    if (csv)
+    {
+        printf("%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%u,%u,%lld,%lld,%llu", (unsigned long long)frame.frame, frame.time, frame.frameMs,
+               frame.cpuMs, frame.gpuMs, frame.presentMs, frame.bodies, frame.drawCalls, frame.triangles, (long long)frame.cpuBytes,
+               (long long)frame.gpuBytes, (unsigned long long)frame.allocations);
+        for (uint32_t i = 0; i < frame.passCount && i < TelemetryFrame::MAX_PASSES; ++i)
+            printf(",%.*s=%.3f", TelemetryFrame::NAME_SIZE, frame.passNames[i], frame.passMs[i]);
+        printf("\n");
+        return;
+    }
+
+    printf("#%-8llu %8.2fs  frame %6.2f ms  cpu %6.2f  gpu %6.2f  present %6.2f  bodies %u  draws %u  tris %u  cpu %.1f MB  gpu %.1f MB ",
+           (unsigned long long)frame.frame, frame.time, frame.frameMs, frame.cpuMs, frame.gpuMs, frame.presentMs, frame.bodies,
+           frame.drawCalls, frame.triangles, frame.cpuBytes / 1048576.0, frame.gpuBytes / 1048576.0);
+    for (uint32_t i = 0; i < frame.passCount && i < TelemetryFrame::MAX_PASSES; ++i)
+        printf(" %.*s %.2f", TelemetryFrame::NAME_SIZE, frame.passNames[i], frame.passMs[i]);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    int pid = 0;
+    bool csv = false;
+    int intervalMs = 100;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--csv") == 0)
+            csv = true;
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+            intervalMs = atoi(argv[++i]);
+        else
+            pid = atoi(argv[i]);
+    }
+
+    if (pid == 0)
+        pid = findApp();
+    TelemetryBlock *block = pid ? Telemetry::attach(pid) : NULL;
+    if (!block)
+    {
+        std::cout << "No running solar-system found" << std::endl;
+        return 1;
+    }
+
+    if (csv)
+        printf("frame,time,frame_ms,cpu_ms,gpu_ms,present_ms,bodies,draw_calls,triangles,cpu_bytes,gpu_bytes,allocations,passes\n");
+
+    // start with the newest frame
+    uint64_t next = block->written.load(std::memory_order_acquire);
+    next = next > 0 ? next - 1 : 0;
+    unsigned long long skipped = 0;
+
+    while (kill(pid, 0) == 0)
+    {
+        uint64_t written = block->written.load(std::memory_order_acquire);
+        if (written > next + TelemetryBlock::SLOTS)
+        {
+            skipped += written - TelemetryBlock::SLOTS - next;
+            next = written - TelemetryBlock::SLOTS;
+        }
+        for (; next < written; ++next)
+        {
+            TelemetryFrame frame;
+            if (Telemetry::read(block, next, frame))
+                printFrame(frame, csv);
+            else
+                skipped++;
+        }
+        fflush(stdout);
+        usleep(intervalMs * 1000);
+    }
+
+    if (skipped)
+        std::cerr << skipped << " frames skipped" << std::endl;
+    Telemetry::detach(block);
+    return 0;
+}
@@ -0,0 +1,504 @@
+// Bakes texture maps into KTX2 files with a full mip chain, which TextureManager
+// uploads as they are instead of decoding the JPG/PNG and calling glGenerateMipmap.
+// Run from src/:
+//   ../build/texture_baker [--format auto|bc1|bc3|rgba8] [--linear] [--no-wrap] textures/*.jpg textures/*.png
+// Each input is written next to itself as <name>.ktx2. auto picks BC3 for images
+// with alpha, BC1 otherwise; rgba8 keeps the mips uncompressed.
+//
+// Every level is filtered from the full image with a Kaiser windowed sinc, in linear
+// light (unless --linear, for data maps) and with premultiplied alpha. The maps are
+// equirectangular, so the filter wraps across the left/right seam (unless --no-wrap)
+// and clamps at the poles.
+
+#include "Ktx2.h"
+#include <stb_image.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Image
+{
+    int width;
+    int height;
+    std::vector<unsigned char> rgba;
+};
+
+// linear light, premultiplied alpha
+struct FloatImage
+{
+    int width;
+    int height;
+    std::vector<float> rgba;
+};
+
+struct FilterOptions
+{
+    bool srgb; // color maps; filter in linear light
+    bool wrap; // equirectangular maps wrap around horizontally
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// mip chain: Kaiser windowed sinc, separable, every level from level 0
+///////////////////////////////////////////////////////////////////////////////
+static const float FILTER_RADIUS = 3.0f; // lobes, in destination pixels
+static const float KAISER_ALPHA = 4.0f;
+
+static float besselI0(float x)
+{
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 20; ++k)
+    {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static float kaiserSinc(float x)
+{
+    if (fabsf(x) >= FILTER_RADIUS)
+        return 0.0f;
+    float sinc = x == 0.0f ? 1.0f : sinf(3.14159265f * x) / (3.14159265f * x);
+    float t = x / FILTER_RADIUS;
+    return sinc * besselI0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / besselI0(KAISER_ALPHA);
+}
+
+static float srgbToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static FloatImage toFloat(const Image &image, const FilterOptions &options)
+{
+    float table[256];
+    for (int i = 0; i < 256; ++i)
+        table[i] = options.srgb ? srgbToLinear(i / 255.0f) : i / 255.0f;
+
+    FloatImage result;
+    result.width = image.width;
+    result.height = image.height;
+    result.rgba.resize(image.rgba.size());
+    for (size_t i = 0; i < image.rgba.size(); i += 4)
+    {
+        float alpha = image.rgba[i + 3] / 255.0f;
+        for (int c = 0; c < 3; ++c)
+            result.rgba[i + c] = table[image.rgba[i + c]] * alpha;
+        result.rgba[i + 3] = alpha;
+    }
+    return result;
+}
+
+static Image toBytes(const FloatImage &image, const FilterOptions &options)
+{
+    Image result;
+    result.width = image.width;
+    result.height = image.height;
+    result.rgba.resize(image.rgba.size());
+    for (size_t i = 0; i < image.rgba.size(); i += 4)
+    {
+        float alpha = fminf(fmaxf(image.rgba[i + 3], 0.0f), 1.0f);
+        for (int c = 0; c < 3; ++c)
+        {
+            float value = alpha > 0.0f ? fminf(fmaxf(image.rgba[i + c] / alpha, 0.0f), 1.0f) : 0.0f;
+            if (options.srgb)
+                value = linearToSrgb(value);
+            result.rgba[i + c] = (unsigned char)lroundf(value * 255.0f);
+        }
+        result.rgba[i + 3] = (unsigned char)lroundf(alpha * 255.0f);
+    }
+    return result;
+}
+
+struct Tap
+{
+    int index;
+    float weight;
+};
+
+// taps for each destination pixel along one axis, normalised to sum to 1
+static std::vector<std::vector<Tap>> makeTaps(int sourceSize, int size, bool wrap)
+{
+    float scale = (float)sourceSize / size;
+    float support = FILTER_RADIUS * scale;
+    std::vector<std::vector<Tap>> taps(size);
+    for (int i = 0; i < size; ++i)
+    {
+        float center = (i + 0.5f) * scale;
+        int first = (int)floorf(center - support), last = (int)ceilf(center + support);
+        float total = 0.0f;
+        for (int j = first; j <= last; ++j)
+        {
+            float weight = kaiserSinc((j + 0.5f - center) / scale);
+            if (weight == 0.0f)
+                continue;
+            int index = wrap ? ((j % sourceSize) + sourceSize) % sourceSize : (j < 0 ? 0 : (j >= sourceSize ? sourceSize - 1 : j));
+            taps[i].push_back({index, weight});
+            total += weight;
+        }
+        for (Tap &tap : taps[i])
+            tap.weight /= total;
+    }
+    return taps;
+}
+
+static FloatImage resample(const FloatImage &source, int width, int height, const FilterOptions &options)
+{
+    // horizontal (wraps at the seam), then vertical (clamps at the poles)
+    std::vector<std::vector<Tap>> columns = makeTaps(source.width, width, options.wrap);
+    std::vector<std::vector<Tap>> rows = makeTaps(source.height, height, false);
+
+    FloatImage wide;
+    wide.width = width;
+    wide.height = source.height;
+    wide.rgba.assign((size_t)width * source.height * 4, 0.0f);
+    for (int y = 0; y < source.height; ++y)
+    {
+        const float *in = &source.rgba[(size_t)y * source.width * 4];
+        float *out = &wide.rgba[(size_t)y * width * 4];
+        for (int x = 0; x < width; ++x)
+            for (const Tap &tap : columns[x])
+                for (int c = 0; c < 4; ++c)
+                    out[x * 4 + c] += in[tap.index * 4 + c] * tap.weight;
+    }
+
+    FloatImage result;
+    result.width = width;
+    result.height = height;
+    result.rgba.assign((size_t)width * height * 4, 0.0f);
+    for (int y = 0; y < height; ++y)
+    {
+        float *out = &result.rgba[(size_t)y * width * 4];
+        for (const Tap &tap : rows[y])
+        {
+            const float *in = &wide.rgba[(size_t)tap.index * width * 4];
+            for (int i = 0; i < width * 4; ++i)
+                out[i] += in[i] * tap.weight;
+        }
+    }
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BC1 / BC3 block encoders
+///////////////////////////////////////////////////////////////////////////////
+static unsigned int to565(const float *color)
+{
+    int r = (int)lroundf(fminf(fmaxf(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)lroundf(fminf(fmaxf(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)lroundf(fminf(fmaxf(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (r << 11) | (g << 5) | b;
+}
+
+static void from565(unsigned int color, float *out)
+{
+    out[0] = (float)(((color >> 11) & 31) * 255 / 31);
+    out[1] = (float)(((color >> 5) & 63) * 255 / 63);
+    out[2] = (float)((color & 31) * 255 / 31);
+}
+
+static void putU16(unsigned char *out, unsigned int value)
+{
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+
+static int findIndices(const float pixels[16][4], const float palette[4][3], unsigned int *indices)
+{
+    float error = 0.0f;
+    *indices = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0;
+        float bestDistance = 1e30f;
+        for (int p = 0; p < 4; ++p)
+        {
+            float dr = pixels[i][0] - palette[p][0], dg = pixels[i][1] - palette[p][1], db = pixels[i][2] - palette[p][2];
+            float distance = dr * dr + dg * dg + db * db;
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                best = p;
+            }
+        }
+        *indices |= best << (2 * i);
+        error += bestDistance;
+    }
+    return (int)error;
+}
+
+// endpoints along the principal axis of the block's colors, then one least
+// squares refit of the endpoints to the chosen indices; 4-color mode only
+static void encodeColorBlock(const float pixels[16][4], unsigned char *out)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+            mean[c] += pixels[i][c] / 16.0f;
+
+    float covariance[6] = {0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        float d[3] = {pixels[i][0] - mean[0], pixels[i][1] - mean[1], pixels[i][2] - mean[2]};
+        covariance[0] += d[0] * d[0];
+        covariance[1] += d[0] * d[1];
+        covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1];
+        covariance[4] += d[1] * d[2];
+        covariance[5] += d[2] * d[2];
+    }
+
+    // power iteration
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[3] = {covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                         covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                         covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+        float length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f)
+            break;
+        for (int c = 0; c < 3; ++c)
+            axis[c] = next[c] / length;
+    }
+
+    float minT = 1e30f, maxT = -1e30f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] + (pixels[i][2] - mean[2]) * axis[2];
+        minT = fminf(minT, t);
+        maxT = fmaxf(maxT, t);
+    }
+    float endpoints[2][3];
+    for (int c = 0; c < 3; ++c)
+    {
+        endpoints[0][c] = mean[c] + axis[c] * maxT;
+        endpoints[1][c] = mean[c] + axis[c] * minT;
+    }
+
+    unsigned int bestColors[2] = {0, 0};
+    unsigned int bestIndices = 0;
+    int bestError = -1;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        unsigned int color0 = to565(endpoints[0]);
+        unsigned int color1 = to565(endpoints[1]);
+        if (color0 < color1)
+        {
+            unsigned int swap = color0;
+            color0 = color1;
+            color1 = swap;
+        }
+
+        float palette[4][3];
+        from565(color0, palette[0]);
+        from565(color1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        unsigned int indices;
+        int error = findIndices(pixels, palette, &indices);
+        if (color0 == color1)
+            indices = 0;
+        if (bestError < 0 || error < bestError)
+        {
+            bestError = error;
+            bestColors[0] = color0;
+            bestColors[1] = color1;
+            bestIndices = indices;
+        }
+        if (color0 == color1)
+            break;
+
+        // least squares endpoints for these indices: pixel = a * e0 + b * e1
+        static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {0.0f}, bx[3] = {0.0f};
+        for (int i = 0; i < 16; ++i)
+        {
+            float a = weights[(indices >> (2 * i)) & 3], b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 3; ++c)
+            {
+                ax[c] += a * pixels[i][c];
+                bx[c] += b * pixels[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (fabsf(determinant) < 1e-6f)
+            break;
+        for (int c = 0; c < 3; ++c)
+        {
+            endpoints[0][c] = (ax[c] * bb - bx[c] * ab) / determinant;
+            endpoints[1][c] = (bx[c] * aa - ax[c] * ab) / determinant;
+        }
+    }
+
+    putU16(out, bestColors[0]);
+    putU16(out + 2, bestColors[1]);
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = (bestIndices >> (8 * i)) & 0xFF;
+}
+
+// 8 alpha values between the block's min and max
+static void encodeAlphaBlock(const float pixels[16][4], unsigned char *out)
+{
+    int minAlpha = 255, maxAlpha = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int alpha = (int)pixels[i][3];
+        minAlpha = alpha < minAlpha ? alpha : minAlpha;
+        maxAlpha = alpha > maxAlpha ? alpha : maxAlpha;
+    }
+
+    out[0] = (unsigned char)maxAlpha;
+    out[1] = (unsigned char)minAlpha;
+    float palette[8];
+    palette[0] = (float)maxAlpha;
+    palette[1] = (float)minAlpha;
+    for (int i = 1; i < 7; ++i)
+        palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7.0f;
+
+    unsigned long long bits = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0;
+        for (int p = 1; p < 8; ++p)
+        {
+            if (fabsf(pixels[i][3] - palette[p]) < fabsf(pixels[i][3] - palette[best]))
+                best = p;
+        }
+        bits |= (unsigned long long)best << (3 * i);
+    }
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = (bits >> (8 * i)) & 0xFF;
+}
+
+static std::vector<unsigned char> compress(const Image &image, unsigned int format)
+{
+    int blockBytes = Ktx2::getBlockBytes(format);
+    int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+    std::vector<unsigned char> out((size_t)blocksX * blocksY * blockBytes);
+
+    for (int by = 0; by < blocksY; ++by)
+    {
+        for (int bx = 0; bx < blocksX; ++bx)
+        {
+            // edge blocks repeat the last row/column
+            float pixels[16][4];
+            for (int i = 0; i < 16; ++i)
+            {
+                int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                x = x < image.width ? x : image.width - 1;
+                y = y < image.height ? y : image.height - 1;
+                for (int c = 0; c < 4; ++c)
+                    pixels[i][c] = image.rgba[((size_t)y * image.width + x) * 4 + c];
+            }
+
+            unsigned char *block = &out[((size_t)by * blocksX + bx) * blockBytes];
+            if (blockBytes == 16)
+            {
+                encodeAlphaBlock(pixels, block);
+                block += 8;
+            }
+            encodeColorBlock(pixels, block);
+        }
+    }
+    return out;
+}
+
+static bool bake(const char *path, const char *formatName, const FilterOptions &options)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char *data = stbi_load(path, &width, &height, &channels, 4);
+    if (!data)
+    {
+        printf("Failed to load texture: %s\n", path);
+        return false;
+    }
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgba.assign(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+
+    bool hasAlpha = false;
+    for (size_t i = 3; i < image.rgba.size(); i += 4)
+        hasAlpha |= image.rgba[i] != 255;
+
+    unsigned int format = hasAlpha ? KTX2_BC3_UNORM : KTX2_BC1_RGB_UNORM;
+    if (strcmp(formatName, "bc1") == 0)
+        format = KTX2_BC1_RGB_UNORM;
+    else if (strcmp(formatName, "bc3") == 0)
+        format = KTX2_BC3_UNORM;
+    else if (strcmp(formatName, "rgba8") == 0)
+        format = KTX2_R8G8B8A8_UNORM;
+
+    std::vector<std::vector<unsigned char>> levels;
+    size_t sourceBytes = image.rgba.size() * 3 / 4, bakedBytes = 0;
+    FloatImage base = toFloat(image, options);
+    for (int level = 0;; ++level)
+    {
+        int levelWidth = width >> level ? width >> level : 1;
+        int levelHeight = height >> level ? height >> level : 1;
+        if (level > 0)
+            image = toBytes(resample(base, levelWidth, levelHeight, options), options);
+
+        levels.push_back(Ktx2::isCompressed(format) ? compress(image, format) : image.rgba);
+        bakedBytes += levels.back().size();
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+    }
+
+    std::string output = path;
+    size_t dot = output.find_last_of('.');
+    output = output.substr(0, dot) + ".ktx2";
+    if (!Ktx2::write(output.c_str(), format, levels, width, height))
+        return false;
+
+    const char *name = format == KTX2_BC3_UNORM ? "BC3" : (format == KTX2_BC1_RGB_UNORM ? "BC1" : "RGBA8");
+    printf("%-28s %5d x %-5d %d ch -> %s, %zu levels, %zu KB (RGB8 + mips %zu KB)\n", output.c_str(), width, height, channels, name,
+           levels.size(), bakedBytes / 1024, sourceBytes * 4 / 3 / 1024);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *format = "auto";
+    FilterOptions options = {true, true};
+    std::vector<const char *> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+            format = argv[++i];
+        else if (strcmp(argv[i], "--linear") == 0)
+            options.srgb = false;
+        else if (strcmp(argv[i], "--no-wrap") == 0)
+            options.wrap = false;
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if (paths.empty())
+    {
+        printf("Usage: texture_baker [--format auto|bc1|bc3|rgba8] [--linear] [--no-wrap] image...\n");
+        return 2;
+    }
+
+    int failed = 0;
+    for (const char *path : paths)
+        failed += !bake(path, format, options);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,327 @@
+// Cuts a very large texture map into the tiled page file the virtual texture
+// cache streams from, for surface maps too big to ever be resident.
+// Run from src/:
+//   ../build/texture_tiler [--linear] [-o textures/earthmap1k.vtex] earth_16k.jpg
+//   ../build/texture_tiler [--linear] --strips -o textures/earthmap1k.vtex earth_64k_0.png ... earth_64k_7.png
+// Without -o the page file is written next to the (first) input as <name>.vtex.
+// The app picks up textures/<name>.vtex for the body whose map is
+// textures/<name>.jpg.
+//
+// stb_image decodes a whole image at once and refuses more than 2 GB of RGBA
+// (e.g. 32768x16384). Larger maps are split into horizontal strips beforehand
+// and passed top to bottom with --strips; each strip has to fit, and together
+// they have to be power of two sizes. A single image is resampled up to power
+// of two sizes if it isn't already.
+//
+// The levels are written a row of tiles at a time, as the rows of level 0 come
+// in: each level keeps only the rows its next row of tiles needs, and passes
+// every pair of rows on to the next level as one row, a 2x2 box filter in
+// linear light (unless --linear, for data maps). The maps are equirectangular,
+// so tile borders wrap across the left/right seam and clamp at the poles.
+
+#include "PageFile.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+struct Image
+{
+    int width;
+    int height;
+    std::vector<unsigned char> rgba;
+};
+
+static float toLinear[256];
+
+static void initTables(bool srgb)
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        float value = i / 255.0f;
+        toLinear[i] = srgb ? (value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f)) : value;
+    }
+}
+
+static unsigned char fromLinear(float value, bool srgb)
+{
+    if (srgb)
+        value = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (unsigned char)(value * 255.0f + 0.5f);
+}
+
+static int nextPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value)
+        result *= 2;
+    return result;
+}
+
+// bilinear, wrapping horizontally
+static Image resize(const unsigned char *source, int sourceWidth, int sourceHeight, int width, int height, bool srgb)
+{
+    Image result = {width, height, std::vector<unsigned char>((size_t)width * height * 4)};
+    for (int y = 0; y < height; ++y)
+    {
+        float sy = (y + 0.5f) * sourceHeight / height - 0.5f;
+        int y0 = (int)floorf(sy);
+        float fy = sy - y0;
+        int y1 = y0 + 1 < sourceHeight ? y0 + 1 : sourceHeight - 1;
+        y0 = y0 < 0 ? 0 : y0;
+        for (int x = 0; x < width; ++x)
+        {
+            float sx = (x + 0.5f) * sourceWidth / width - 0.5f;
+            int x0 = (int)floorf(sx);
+            float fx = sx - x0;
+            int x1 = (x0 + 1) % sourceWidth;
+            x0 = (x0 + sourceWidth) % sourceWidth;
+
+            const unsigned char *p00 = &source[((size_t)y0 * sourceWidth + x0) * 4];
+            const unsigned char *p10 = &source[((size_t)y0 * sourceWidth + x1) * 4];
+            const unsigned char *p01 = &source[((size_t)y1 * sourceWidth + x0) * 4];
+            const unsigned char *p11 = &source[((size_t)y1 * sourceWidth + x1) * 4];
+            unsigned char *out = &result.rgba[((size_t)y * width + x) * 4];
+            for (int c = 0; c < 4; ++c)
+            {
+                bool color = srgb && c < 3;
+                float a = color ? toLinear[p00[c]] : p00[c] / 255.0f;
+                float b = color ? toLinear[p10[c]] : p10[c] / 255.0f;
+                float d = color ? toLinear[p01[c]] : p01[c] / 255.0f;
+                float e = color ? toLinear[p11[c]] : p11[c] / 255.0f;
+                float value = (a * (1 - fx) + b * fx) * (1 - fy) + (d * (1 - fx) + e * fx) * fy;
+                out[c] = fromLinear(value, color);
+            }
+        }
+    }
+    return result;
+}
+
+// 2x2 box filter of two rows into one; exact for power of two sizes.
+// upper and lower are the same row when the level is one texel high.
+static std::vector<unsigned char> halve(const std::vector<unsigned char> &upper, const std::vector<unsigned char> &lower, int sourceWidth, bool srgb)
+{
+    int width = sourceWidth > 1 ? sourceWidth / 2 : 1;
+    std::vector<unsigned char> result((size_t)width * 4);
+    for (int x = 0; x < width; ++x)
+    {
+        int x0 = sourceWidth > 1 ? x * 2 : 0;
+        int x1 = sourceWidth > 1 ? x * 2 + 1 : 0;
+        const unsigned char *p[4] = {&lower[(size_t)x0 * 4], &lower[(size_t)x1 * 4], &upper[(size_t)x0 * 4], &upper[(size_t)x1 * 4]};
+        for (int c = 0; c < 4; ++c)
+        {
+            bool color = srgb && c < 3;
+            float sum = 0.0f;
+            for (int i = 0; i < 4; ++i)
+                sum += color ? toLinear[p[i][c]] : p[i][c] / 255.0f;
+            result[(size_t)x * 4 + c] = fromLinear(sum * 0.25f, color);
+        }
+    }
+    return result;
+}
+
+// one level of the page file being written, fed its rows top to bottom
+struct Level
+{
+    int width;
+    int height;
+    int tileRow; // next row of tiles to write, the top one first
+    std::map<int, std::vector<unsigned char>> rows; // by GL row (bottom-up), those tileRow still needs
+};
+
+static bool writeTileRow(PageFile &file, int level, const Level &image)
+{
+    std::vector<unsigned char> tile(PageFile::TILE_BYTES);
+    int ty = image.tileRow;
+    for (int tx = 0; tx < file.getTilesX(level); ++tx)
+    {
+        for (int sy = 0; sy < PageFile::TILE_STRIDE; ++sy)
+        {
+            int y = ty * PageFile::TILE_SIZE + sy - PageFile::BORDER;
+            y = y < 0 ? 0 : (y >= image.height ? image.height - 1 : y);
+            const std::vector<unsigned char> &row = image.rows.at(y);
+            for (int sx = 0; sx < PageFile::TILE_STRIDE; ++sx)
+            {
+                int x = tx * PageFile::TILE_SIZE + sx - PageFile::BORDER;
+                x = ((x % image.width) + image.width) % image.width;
+                memcpy(&tile[((size_t)sy * PageFile::TILE_STRIDE + sx) * 4], &row[(size_t)x * 4], 4);
+            }
+        }
+        if (!file.writeTile(level, tx, ty, tile.data()))
+            return false;
+    }
+    return true;
+}
+
+// takes GL row y of a level, the rows above it have all been pushed already
+static bool pushRow(PageFile &file, std::vector<Level> &levels, int level, int y, std::vector<unsigned char> row, bool srgb)
+{
+    Level &image = levels[level];
+    image.rows[y] = std::move(row);
+
+    // every second row completes one of the next level
+    if (level + 1 < (int)levels.size() && (image.height == 1 || y % 2 == 0))
+    {
+        const std::vector<unsigned char> &lower = image.rows[y];
+        const std::vector<unsigned char> &upper = image.height == 1 ? lower : image.rows.at(y + 1);
+        if (!pushRow(file, levels, level + 1, y / 2, halve(upper, lower, image.width, srgb), srgb))
+            return false;
+    }
+
+    // a row of tiles is complete once the bottom border below it is in
+    while (image.tileRow >= 0 && y <= std::max(0, image.tileRow * PageFile::TILE_SIZE - PageFile::BORDER))
+    {
+        if (!writeTileRow(file, level, image))
+            return false;
+        image.tileRow--;
+        int top = image.tileRow * PageFile::TILE_SIZE + PageFile::TILE_SIZE + PageFile::BORDER - 1;
+        image.rows.erase(image.rows.upper_bound(top), image.rows.end());
+    }
+    return true;
+}
+
+static bool isPowerOfTwo(int value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+// stb_image rejects images whose RGBA8 pixels don't fit in an int
+static bool fitsDecoder(const char *path, int width, int height)
+{
+    if ((long long)width * height * 4 <= INT_MAX)
+        return true;
+    printf("%s is %dx%d, %.1f GB of RGBA: more than stb_image decodes at once (2 GB).\n"
+           "Split it into horizontal strips and pass them top to bottom with --strips.\n",
+           path, width, height, (double)width * height * 4 / (1 << 30));
+    return false;
+}
+
+// paths are one image, or the horizontal strips of one image top to bottom
+static bool tile(const std::vector<const char *> &paths, const char *outPath, bool srgb)
+{
+    const char *path = paths[0];
+    int sourceWidth = 0, sourceHeight = 0;
+    std::vector<int> stripHeights;
+    for (const char *strip : paths)
+    {
+        int width, height, channels;
+        if (!stbi_info(strip, &width, &height, &channels))
+        {
+            printf("Failed to load %s\n", strip);
+            return false;
+        }
+        if (!fitsDecoder(strip, width, height))
+            return false;
+        if (sourceWidth && width != sourceWidth)
+        {
+            printf("%s is %d wide, the strips before it %d\n", strip, width, sourceWidth);
+            return false;
+        }
+        sourceWidth = width;
+        sourceHeight += height;
+        stripHeights.push_back(height);
+    }
+
+    int width = nextPowerOfTwo(sourceWidth);
+    int height = nextPowerOfTwo(sourceHeight);
+    if (paths.size() > 1 && (!isPowerOfTwo(sourceWidth) || !isPowerOfTwo(sourceHeight)))
+    {
+        printf("Strips add up to %dx%d, which is not power of two sizes\n", sourceWidth, sourceHeight);
+        return false;
+    }
+
+    std::string out = outPath ? std::string(outPath) : std::string(path).substr(0, std::string(path).find_last_of('.')) + ".vtex";
+    PageFile file;
+    if (!file.create(out.c_str(), width, height))
+        return false;
+
+    std::vector<Level> levels(file.getLevelCount());
+    for (int level = 0; level < file.getLevelCount(); ++level)
+    {
+        levels[level].width = width >> level ? width >> level : 1;
+        levels[level].height = height >> level ? height >> level : 1;
+        levels[level].tileRow = file.getTilesY(level) - 1;
+    }
+
+    // image rows come top-down, the page file's are bottom-up as GL wants them
+    int y = height;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        int stripWidth, stripHeight, channels;
+        unsigned char *pixels = stbi_load(paths[i], &stripWidth, &stripHeight, &channels, 4);
+        if (!pixels || stripWidth != sourceWidth || stripHeight != stripHeights[i])
+        {
+            printf("Failed to load %s\n", paths[i]);
+            stbi_image_free(pixels);
+            return false;
+        }
+
+        Image resized = {0, 0, std::vector<unsigned char>()};
+        const unsigned char *source = pixels;
+        // only a single image is resampled, strips are checked to be power of two sizes
+        if (paths.size() == 1 && (width != stripWidth || height != stripHeight))
+        {
+            resized = resize(pixels, stripWidth, stripHeight, width, height, srgb);
+            stbi_image_free(pixels);
+            pixels = NULL;
+            source = resized.rgba.data();
+            stripHeight = height;
+        }
+
+        bool ok = true;
+        size_t rowBytes = (size_t)width * 4;
+        for (int row = 0; row < stripHeight && ok; ++row)
+            ok = pushRow(file, levels, 0, --y, std::vector<unsigned char>(source + row * rowBytes, source + (row + 1) * rowBytes), srgb);
+        stbi_image_free(pixels);
+        if (!ok)
+        {
+            printf("Failed to write %s\n", out.c_str());
+            return false;
+        }
+    }
+
+    printf("%s: %dx%d, %d levels, %d tiles at level 0 -> %s\n", path, width, height, file.getLevelCount(),
+           file.getTilesX(0) * file.getTilesY(0), out.c_str());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool srgb = true;
+    bool strips = false;
+    const char *outPath = NULL;
+    std::vector<const char *> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--linear") == 0)
+            srgb = false;
+        else if (strcmp(argv[i], "--strips") == 0)
+            strips = true;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if (paths.empty() || (outPath && paths.size() > 1 && !strips))
+    {
+        printf("Usage: texture_tiler [--linear] [-o out.vtex] image...\n"
+               "       texture_tiler [--linear] --strips [-o out.vtex] top.png ... bottom.png\n");
+        return 2;
+    }
+
+    initTables(srgb);
+    if (strips)
+        return tile(paths, outPath, srgb) ? 0 : 1;
+
+    int failed = 0;
+    for (const char *path : paths)
+        failed += !tile(std::vector<const char *>(1, path), outPath, srgb);
+    return failed ? 1 : 0;
+}